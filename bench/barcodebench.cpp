@@ -0,0 +1,438 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+//
+// Offline replay benchmark for the barcode scanner. Feeds recorded or synthetic
+// frames through the same BarcodeReader filter the viewfinder uses, at a fixed
+// camera frame rate, and reports how the scanner keeps up. The inventory scan
+// of full resolution stills is timed on a generated shelf shot.
+
+#include "inventoryscanner.h"
+#include "zxingreader.h"
+
+#include <MultiFormatWriter.h>
+#include <BitMatrix.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QVideoFrame>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+// A 12MP shelf shot with this many labels is meant to be scanned in under a second
+#define INVENTORY_CODES 50
+
+struct Sequence {
+    QString name;
+    QSize size;
+    QVideoFrame::PixelFormat format = QVideoFrame::Format_Invalid;
+    QList<QByteArray> frames;
+};
+
+struct SequenceStats {
+    int fed = 0;
+    int dropped = 0;
+    int decodes = 0;
+    int detections = 0;
+    qint64 firstDetectionMs = -1;
+    qint64 wallMs = 0;
+    double cpuMs = 0;
+};
+
+static double processCpuMs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int planarFrameSize(const QSize &size)
+{
+    return size.width() * size.height() * 3 / 2;
+}
+
+static QVideoFrame toVideoFrame(const Sequence &seq, const QByteArray &data)
+{
+    QVideoFrame frame(data.size(), seq.size, seq.size.width(), seq.format);
+    if (frame.map(QAbstractVideoBuffer::WriteOnly)) {
+        memcpy(frame.bits(), data.constData(), data.size());
+        frame.unmap();
+    }
+    return frame;
+}
+
+static bool loadY4m(const QString &path, Sequence &seq)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Can't open" << path;
+        return false;
+    }
+
+    const QList<QByteArray> header = file.readLine().trimmed().split(' ');
+    if (header.value(0) != "YUV4MPEG2") {
+        qWarning() << path << "is not a YUV4MPEG2 stream";
+        return false;
+    }
+
+    bool mono = false;
+    for (const QByteArray &token : header.mid(1)) {
+        if (token.startsWith('W')) {
+            seq.size.setWidth(token.mid(1).toInt());
+        } else if (token.startsWith('H')) {
+            seq.size.setHeight(token.mid(1).toInt());
+        } else if (token.startsWith('C')) {
+            mono = token == "Cmono";
+            if (!mono && !token.startsWith("C420")) {
+                qWarning() << path << "uses unsupported colour space" << token;
+                return false;
+            }
+        }
+    }
+
+    const int lumaSize = seq.size.width() * seq.size.height();
+    const int frameSize = mono ? lumaSize : planarFrameSize(seq.size);
+
+    seq.format = QVideoFrame::Format_YUV420P;
+    while (!file.atEnd()) {
+        if (!file.readLine().startsWith("FRAME"))
+            break;
+
+        QByteArray data = file.read(frameSize);
+        if (data.size() != frameSize)
+            break;
+
+        if (mono)
+            data.append(QByteArray(planarFrameSize(seq.size) - lumaSize, char(128)));
+        seq.frames.append(data);
+    }
+
+    return !seq.frames.isEmpty();
+}
+
+static bool loadNv12(const QString &path, const QSize &size, Sequence &seq)
+{
+    if (size.isEmpty()) {
+        qWarning() << "Raw NV12 input needs --size";
+        return false;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Can't open" << path;
+        return false;
+    }
+
+    seq.size = size;
+    seq.format = QVideoFrame::Format_NV12;
+
+    const int frameSize = planarFrameSize(size);
+    while (true) {
+        QByteArray data = file.read(frameSize);
+        if (data.size() != frameSize)
+            break;
+        seq.frames.append(data);
+    }
+
+    return !seq.frames.isEmpty();
+}
+
+// Renders a code onto a noisy, slowly shifting gradient, in the spirit of
+// videotestsrc. The code only appears after the first third of the sequence so
+// the time to first detection is meaningful.
+static Sequence syntheticSequence(ZXing::BarcodeFormat format, const QString &text, const QSize &codeSize, int count)
+{
+    Sequence seq;
+    seq.name = QString("synthetic-%1").arg(QString::fromStdString(ZXing::ToString(format)));
+    seq.size = QSize(1280, 720);
+    seq.format = QVideoFrame::Format_YUV420P;
+
+    ZXing::MultiFormatWriter writer(format);
+    writer.setMargin(4);
+    const ZXing::BitMatrix bits = writer.encode(text.toStdWString(), codeSize.width(), codeSize.height());
+    const ZXing::Matrix<uint8_t> code = ZXing::ToMatrix<uint8_t>(bits);
+
+    const int width = seq.size.width();
+    const int height = seq.size.height();
+    QRandomGenerator rng(42);
+
+    for (int n = 0; n < count; n++) {
+        QByteArray data(planarFrameSize(seq.size), char(128));
+        uchar *luma = reinterpret_cast<uchar *>(data.data());
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                luma[y * width + x] = uchar(((x + n * 4) * 255 / width + y * 64 / height + rng.bounded(24)) & 0xff);
+            }
+        }
+
+        if (n >= count / 3) {
+            const int ox = (width - code.width()) / 2 + int(40 * std::sin(n * 0.1));
+            const int oy = (height - code.height()) / 2;
+            for (int y = 0; y < code.height(); y++) {
+                for (int x = 0; x < code.width(); x++) {
+                    luma[(oy + y) * width + ox + x] = code(x, y) ? 235 : 16;
+                }
+            }
+        }
+
+        seq.frames.append(data);
+    }
+
+    return seq;
+}
+
+// 4000x3000 grayscale shelf shot with a grid of different labels on a noisy
+// background, cycling through the formats the inventory scan is used for
+static QImage inventoryStill(int count)
+{
+    const QSize size(4000, 3000);
+    const int columns = 10;
+    const int rows = (count + columns - 1) / columns;
+    const int cellWidth = size.width() / columns;
+    const int cellHeight = size.height() / std::max(1, rows);
+
+    QImage still(size, QImage::Format_Grayscale8);
+    QRandomGenerator rng(42);
+    for (int y = 0; y < size.height(); y++) {
+        uchar *line = still.scanLine(y);
+        for (int x = 0; x < size.width(); x++) {
+            line[x] = uchar(96 + x * 64 / size.width() + rng.bounded(24));
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        ZXing::BarcodeFormat format;
+        QString text;
+        QSize codeSize;
+
+        switch (i % 4) {
+        case 0:
+            format = ZXing::BarcodeFormat::EAN13;
+            text = QString("400638133%1").arg(i, 3, 10, QChar('0'));
+            codeSize = QSize(300, 120);
+            break;
+        case 1:
+            format = ZXing::BarcodeFormat::Code128;
+            text = QString("SHELF-%1").arg(i, 4, 10, QChar('0'));
+            codeSize = QSize(340, 120);
+            break;
+        case 2:
+            format = ZXing::BarcodeFormat::QRCode;
+            text = QString("https://furilabs.com/item/%1").arg(i);
+            codeSize = QSize(180, 180);
+            break;
+        default:
+            format = ZXing::BarcodeFormat::DataMatrix;
+            text = QString("FURIOS-DM-%1").arg(i, 4, 10, QChar('0'));
+            codeSize = QSize(160, 160);
+            break;
+        }
+
+        ZXing::MultiFormatWriter writer(format);
+        writer.setMargin(4);
+        const ZXing::Matrix<uint8_t> code = ZXing::ToMatrix<uint8_t>(writer.encode(text.toStdWString(), codeSize.width(), codeSize.height()));
+
+        const int ox = (i % columns) * cellWidth + (cellWidth - code.width()) / 2;
+        const int oy = (i / columns) * cellHeight + (cellHeight - code.height()) / 2;
+        for (int y = 0; y < code.height(); y++) {
+            uchar *line = still.scanLine(oy + y);
+            for (int x = 0; x < code.width(); x++) {
+                line[ox + x] = code(x, y) ? 235 : 16;
+            }
+        }
+    }
+
+    return still;
+}
+
+static SequenceStats run(ZXingQt::BarcodeReader &reader, const Sequence &seq, int fps)
+{
+    SequenceStats stats;
+    QList<QVideoFrame> frames;
+    for (const QByteArray &data : seq.frames)
+        frames.append(toVideoFrame(seq, data));
+
+    reader.setActive(true);
+    reader.sleepTime = reader.idleSleepTime;
+    reader.cropRect = QRect();
+    reader.resetLatencyStats();
+
+    QElapsedTimer wall;
+    QEventLoop loop;
+
+    QMetaObject::Connection conn = QObject::connect(&reader, &ZXingQt::BarcodeReader::newResult, &loop,
+                                                    [&](const ZXingQt::Result &result) {
+        stats.decodes++;
+        if (result.isValid()) {
+            stats.detections++;
+            if (stats.firstDetectionMs < 0)
+                stats.firstDetectionMs = wall.elapsed();
+        }
+    });
+
+    QTimer camera;
+    camera.setTimerType(Qt::PreciseTimer);
+    camera.setInterval(1000 / fps);
+
+    int next = 0;
+    QObject::connect(&camera, &QTimer::timeout, &loop, [&] {
+        if (next == frames.size()) {
+            // Let the last decode finish before stopping the clock
+            if (!reader.busy) {
+                camera.stop();
+                loop.quit();
+            }
+            return;
+        }
+
+        stats.fed++;
+        // An inactive filter is skipped by VideoOutput, so that frame is lost too
+        if (!reader.isActive() || !reader.process(frames[next]))
+            stats.dropped++;
+        next++;
+    });
+
+    const double cpuStart = processCpuMs();
+    wall.start();
+    camera.start();
+    loop.exec();
+
+    stats.wallMs = wall.elapsed();
+    stats.cpuMs = processCpuMs() - cpuStart;
+
+    // Deliver the result of the last decode, it is queued from the worker thread
+    QCoreApplication::processEvents();
+    QObject::disconnect(conn);
+    return stats;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("barcode-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays frame sequences through the barcode scanner");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Y4M (4:2:0 or mono) or raw NV12 sequences");
+    parser.addOptions({
+        {"size", "Frame size of raw NV12 input.", "WxH"},
+        {"fps", "Camera frame rate to replay at.", "fps", "30"},
+        {"synthetic", "Add generated QR, DataMatrix, EAN-13 and Code128 sequences of this length.", "frames"},
+        {"sleep-time", "Sampling interval while nothing is found (ms).", "ms"},
+        {"tracking-sleep-time", "Sampling interval while tracking a code (ms).", "ms"},
+        {"padding", "Crop padding around a found code (px).", "px"},
+        {"min-crop", "Smallest crop around a found code (px).", "px"},
+        {"formats", "ZXing format mask.", "mask"},
+        {"rotation-period", "Frames per format rotation, 0 for the default.", "frames"},
+        {"try-harder", "Enable tryHarder."},
+        {"try-rotate", "Enable tryRotate."},
+        {"no-downscale", "Disable tryDownscale."},
+        {"latency", "Print the scanner's latency histograms for each sequence."},
+        {"inventory", "Time this many inventory scans of a generated 12MP still with 50 codes.", "runs"},
+    });
+    parser.process(app);
+
+    ZXingQt::registerQmlAndMetaTypes();
+
+    // Same defaults as QrCode.qml
+    ZXingQt::BarcodeReader reader;
+    reader.setFormats(int(ZXingQt::BarcodeFormat::QRCode) | int(ZXingQt::BarcodeFormat::DataMatrix) |
+                      int(ZXingQt::BarcodeFormat::EAN13) | int(ZXingQt::BarcodeFormat::Code128));
+    reader.setTryRotate(parser.isSet("try-rotate"));
+    reader.setTryHarder(parser.isSet("try-harder"));
+    reader.setTryDownscale(!parser.isSet("no-downscale"));
+
+    if (parser.isSet("formats"))
+        reader.setFormats(parser.value("formats").toInt(nullptr, 0));
+    if (parser.isSet("rotation-period"))
+        reader.setRotationPeriod(parser.value("rotation-period").toInt());
+    if (parser.isSet("sleep-time"))
+        reader.idleSleepTime = parser.value("sleep-time").toInt();
+    if (parser.isSet("tracking-sleep-time"))
+        reader.trackingSleepTime = parser.value("tracking-sleep-time").toInt();
+    if (parser.isSet("padding"))
+        reader.cropPadding = parser.value("padding").toInt();
+    if (parser.isSet("min-crop"))
+        reader.minCropSize = parser.value("min-crop").toInt();
+
+    QSize rawSize;
+    if (parser.isSet("size")) {
+        const QStringList dims = parser.value("size").split('x');
+        rawSize = QSize(dims.value(0).toInt(), dims.value(1).toInt());
+    }
+
+    QList<Sequence> sequences;
+    for (const QString &path : parser.positionalArguments()) {
+        Sequence seq;
+        seq.name = QFileInfo(path).fileName();
+        bool ok = path.endsWith(".y4m", Qt::CaseInsensitive) ? loadY4m(path, seq) : loadNv12(path, rawSize, seq);
+        if (ok)
+            sequences.append(seq);
+    }
+
+    if (parser.isSet("synthetic")) {
+        const int count = parser.value("synthetic").toInt();
+        sequences.append(syntheticSequence(ZXing::BarcodeFormat::QRCode, "https://furilabs.com", QSize(240, 240), count));
+        sequences.append(syntheticSequence(ZXing::BarcodeFormat::DataMatrix, "FURIOS-DM-0001", QSize(200, 200), count));
+        sequences.append(syntheticSequence(ZXing::BarcodeFormat::EAN13, "4006381333931", QSize(380, 140), count));
+        sequences.append(syntheticSequence(ZXing::BarcodeFormat::Code128, "FURIOS-0001", QSize(420, 140), count));
+    }
+
+    const int inventoryRuns = parser.value("inventory").toInt();
+
+    if (sequences.isEmpty() && inventoryRuns <= 0) {
+        parser.showHelp(1);
+    }
+
+    const int fps = std::max(1, parser.value("fps").toInt());
+
+    if (!sequences.isEmpty())
+        printf("%-28s %7s %7s %9s %10s %9s %9s\n", "sequence", "frames", "dropped", "first(ms)", "decodes/s", "detect%", "cpu ms/f");
+    for (const Sequence &seq : sequences) {
+        SequenceStats stats = run(reader, seq, fps);
+        const int decoded = std::max(1, stats.fed - stats.dropped);
+
+        printf("%-28s %7d %7d %9lld %10.1f %8.1f%% %9.2f\n",
+               qPrintable(seq.name),
+               stats.fed,
+               stats.dropped,
+               stats.firstDetectionMs,
+               stats.decodes * 1000.0 / std::max<qint64>(1, stats.wallMs),
+               stats.decodes ? 100.0 * stats.detections / stats.decodes : 0.0,
+               stats.cpuMs / decoded);
+
+        if (parser.isSet("latency"))
+            printf("%s\n\n", qPrintable(reader.latencySummary()));
+    }
+
+    if (inventoryRuns > 0) {
+        // Every tile is decoded with tryHarder and tryRotate, as in the app
+        const QImage still = inventoryStill(INVENTORY_CODES);
+        QVector<qint64> times;
+        int found = 0;
+
+        for (int i = 0; i < inventoryRuns; i++) {
+            QElapsedTimer timer;
+            timer.start();
+            found = InventoryScanner::decodeImage(still).size();
+            times.append(timer.elapsed());
+        }
+        std::sort(times.begin(), times.end());
+
+        printf("\n%-28s %7s %7s %9s %9s\n", "inventory still", "codes", "found", "p50(ms)", "max(ms)");
+        printf("%-28s %7d %7d %9lld %9lld\n", "synthetic-4000x3000", INVENTORY_CODES, found,
+               times[times.size() / 2], times.last());
+    }
+
+    return 0;
+}
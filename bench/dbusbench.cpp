@@ -0,0 +1,585 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+//
+// Round trip benchmark for the NetworkManager and GeoClue integration. Starts a
+// private dbus-daemon, serves stand-in NetworkManager and GeoClue2 services on it
+// from a child process, points the system bus at it and times what the camera
+// does over D-Bus, counting every call the services receive.
+
+#include "qrcodehandler.h"
+#include "geocluefind.h"
+#include "wifisignalmonitor.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMetaType>
+#include <QDBusObjectPath>
+#include <QDBusVirtualObject>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+
+#define NM_SERVICE "org.freedesktop.NetworkManager"
+#define NM_PATH "/org/freedesktop/NetworkManager"
+#define GEOCLUE_SERVICE "org.freedesktop.GeoClue2"
+#define GEOCLUE_PATH "/org/freedesktop/GeoClue2"
+#define CONTROL_PATH "/org/freedesktop/BenchControl"
+#define CONTROL_INTERFACE "io.furios.BenchControl"
+#define PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
+
+// The Wi-Fi code every join scans
+#define JOIN_SSID "ssid-7"
+
+typedef QMap<QString, QVariantMap> ConnectionSettings;
+
+struct CallStats {
+    uint networkManager = 0;
+    uint geoClue = 0;
+    uint introspections = 0;
+};
+
+// Serves everything below /org/freedesktop. Replies are sent after the configured
+// latency without blocking other calls, like a daemon answering from its main loop.
+class MockServices : public QDBusVirtualObject
+{
+public:
+    MockServices(int accessPoints, int connections, int latency)
+        : m_accessPoints(accessPoints), m_latency(latency), m_nextConnection(0), m_nextActive(0), m_nextClient(0),
+          m_wirelessEnabled(true), m_bus(QDBusConnection::systemBus())
+    {
+        // Every SSID has a few saved profiles, like a phone that has been around
+        for (int i = 0; i < connections; i++)
+            m_connections.insert(m_nextConnection++, QString("ssid-%1").arg(i % std::max(1, accessPoints)));
+    }
+
+    QString introspect(const QString &path) const override
+    {
+        QString xml = "<interface name=\"org.freedesktop.DBus.Properties\">"
+                      "<method name=\"Get\"><arg type=\"s\" direction=\"in\"/><arg type=\"s\" direction=\"in\"/><arg type=\"v\" direction=\"out\"/></method>"
+                      "<method name=\"GetAll\"><arg type=\"s\" direction=\"in\"/><arg type=\"a{sv}\" direction=\"out\"/></method>"
+                      "<method name=\"Set\"><arg type=\"s\" direction=\"in\"/><arg type=\"s\" direction=\"in\"/><arg type=\"v\" direction=\"in\"/></method>"
+                      "<signal name=\"PropertiesChanged\"><arg type=\"s\"/><arg type=\"a{sv}\"/><arg type=\"as\"/></signal>"
+                      "</interface>";
+
+        if (path == GEOCLUE_PATH "/Manager") {
+            xml += "<interface name=\"org.freedesktop.GeoClue2.Manager\">"
+                   "<method name=\"GetClient\"><arg type=\"o\" direction=\"out\"/></method>"
+                   "<method name=\"CreateClient\"><arg type=\"o\" direction=\"out\"/></method>"
+                   "<method name=\"DeleteClient\"><arg type=\"o\" direction=\"in\"/></method>"
+                   "</interface>";
+        } else if (path.startsWith(GEOCLUE_PATH "/Client/")) {
+            xml += "<interface name=\"org.freedesktop.GeoClue2.Client\">"
+                   "<property name=\"Location\" type=\"o\" access=\"read\"/>"
+                   "<property name=\"DistanceThreshold\" type=\"u\" access=\"readwrite\"/>"
+                   "<property name=\"TimeThreshold\" type=\"u\" access=\"readwrite\"/>"
+                   "<property name=\"DesktopId\" type=\"s\" access=\"readwrite\"/>"
+                   "<property name=\"RequestedAccuracyLevel\" type=\"u\" access=\"readwrite\"/>"
+                   "<property name=\"Active\" type=\"b\" access=\"read\"/>"
+                   "<method name=\"Start\"/><method name=\"Stop\"/>"
+                   "<signal name=\"LocationUpdated\"><arg type=\"o\"/><arg type=\"o\"/></signal>"
+                   "</interface>";
+        } else if (path.startsWith(GEOCLUE_PATH "/Location/")) {
+            xml += "<interface name=\"org.freedesktop.GeoClue2.Location\">"
+                   "<property name=\"Latitude\" type=\"d\" access=\"read\"/>"
+                   "<property name=\"Longitude\" type=\"d\" access=\"read\"/>"
+                   "<property name=\"Accuracy\" type=\"d\" access=\"read\"/>"
+                   "<property name=\"Altitude\" type=\"d\" access=\"read\"/>"
+                   "<property name=\"Speed\" type=\"d\" access=\"read\"/>"
+                   "<property name=\"Heading\" type=\"d\" access=\"read\"/>"
+                   "<property name=\"Description\" type=\"s\" access=\"read\"/>"
+                   "</interface>";
+        }
+
+        return xml;
+    }
+
+    // Called on the D-Bus thread, the work is queued to the main thread
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override
+    {
+        Q_UNUSED(connection);
+
+        if (message.path() == CONTROL_PATH) {
+            QMetaObject::invokeMethod(this, [this, message]() { control(message); }, Qt::QueuedConnection);
+            return true;
+        }
+
+        if (message.interface() == "org.freedesktop.DBus.Introspectable")
+            m_introspections++;
+        else if (message.path().startsWith(NM_PATH))
+            m_networkManagerCalls++;
+        else if (message.path().startsWith(GEOCLUE_PATH))
+            m_geoClueCalls++;
+
+        QMetaObject::invokeMethod(this, [this, message]() {
+            if (m_latency > 0)
+                QTimer::singleShot(m_latency, this, [this, message]() { dispatch(message); });
+            else
+                dispatch(message);
+        }, Qt::QueuedConnection);
+
+        return true;
+    }
+
+private:
+    void control(const QDBusMessage &message)
+    {
+        if (message.member() == "Reset") {
+            m_networkManagerCalls = 0;
+            m_geoClueCalls = 0;
+            m_introspections = 0;
+        }
+
+        m_bus.send(message.createReply(QVariantList{uint(m_networkManagerCalls), uint(m_geoClueCalls), uint(m_introspections)}));
+    }
+
+    void dispatch(const QDBusMessage &message)
+    {
+        const QString path = message.path();
+        const QString interface = message.interface();
+        const QString member = message.member();
+        const QVariantList args = message.arguments();
+
+        if (interface == "org.freedesktop.DBus.Introspectable" && member == "Introspect") {
+            reply(message, {"<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\" "
+                            "\"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\"><node>" + introspect(path) + "</node>"});
+        } else if (interface == PROPERTIES_INTERFACE && member == "Get") {
+            const QVariantMap all = properties(path, args.value(0).toString());
+            if (!all.contains(args.value(1).toString()))
+                error(message, "org.freedesktop.DBus.Error.UnknownProperty");
+            else
+                reply(message, {QVariant::fromValue(QDBusVariant(all.value(args.value(1).toString())))});
+        } else if (interface == PROPERTIES_INTERFACE && member == "GetAll") {
+            reply(message, {properties(path, args.value(0).toString())});
+        } else if (interface == PROPERTIES_INTERFACE && member == "Set") {
+            if (path == NM_PATH && args.value(1).toString() == "WirelessEnabled")
+                m_wirelessEnabled = args.value(2).value<QDBusVariant>().variant().toBool();
+            reply(message, {});
+        } else if (path == NM_PATH) {
+            networkManager(message);
+        } else if (path.startsWith(NM_PATH "/Devices/") && (member == "GetAllAccessPoints" || member == "GetAccessPoints")) {
+            reply(message, {QVariant::fromValue(accessPointPaths())});
+        } else if (path == NM_PATH "/Settings" && member == "ListConnections") {
+            QList<QDBusObjectPath> paths;
+            for (int id : m_connections.keys())
+                paths << QDBusObjectPath(QString(NM_PATH "/Settings/%1").arg(id));
+            reply(message, {QVariant::fromValue(paths)});
+        } else if (path.startsWith(NM_PATH "/Settings/")) {
+            settingsConnection(message, path.section('/', -1).toInt());
+        } else if (path.startsWith(GEOCLUE_PATH)) {
+            geoClue(message);
+        } else {
+            error(message, "org.freedesktop.DBus.Error.UnknownMethod");
+        }
+    }
+
+    void networkManager(const QDBusMessage &message)
+    {
+        if (message.member() == "GetDevices" || message.member() == "GetAllDevices") {
+            reply(message, {QVariant::fromValue(devicePaths())});
+        } else if (message.member() == "AddAndActivateConnection") {
+            const ConnectionSettings settings = qdbus_cast<ConnectionSettings>(message.arguments().value(0));
+            const int id = m_nextConnection++;
+            m_connections.insert(id, QString::fromUtf8(settings["802-11-wireless"]["ssid"].toByteArray()));
+
+            const QString settingsPath = QString(NM_PATH "/Settings/%1").arg(id);
+            const QString activePath = QString(NM_PATH "/ActiveConnection/%1").arg(m_nextActive++);
+            m_activeStates.insert(activePath, 1);
+
+            emitSignal(NM_PATH "/Settings", "org.freedesktop.NetworkManager.Settings", "NewConnection", {QVariant::fromValue(QDBusObjectPath(settingsPath))});
+            reply(message, {QVariant::fromValue(QDBusObjectPath(settingsPath)), QVariant::fromValue(QDBusObjectPath(activePath))});
+
+            // Association and DHCP take a few service round trips
+            QTimer::singleShot(3 * m_latency, this, [this, activePath]() {
+                m_activeStates[activePath] = 2;
+                emitSignal(activePath, "org.freedesktop.NetworkManager.Connection.Active", "StateChanged", {2u, 0u});
+            });
+        } else if (message.member() == "DeactivateConnection") {
+            reply(message, {});
+        } else {
+            error(message, "org.freedesktop.DBus.Error.UnknownMethod");
+        }
+    }
+
+    void settingsConnection(const QDBusMessage &message, int id)
+    {
+        if (!m_connections.contains(id)) {
+            error(message, "org.freedesktop.NetworkManager.Settings.InvalidConnection");
+        } else if (message.member() == "GetSettings") {
+            ConnectionSettings settings;
+            settings["connection"]["type"] = "802-11-wireless";
+            settings["connection"]["id"] = m_connections.value(id);
+            settings["802-11-wireless"]["ssid"] = m_connections.value(id).toUtf8();
+            reply(message, {QVariant::fromValue(settings)});
+        } else if (message.member() == "Delete") {
+            m_connections.remove(id);
+            reply(message, {});
+            emitSignal(NM_PATH "/Settings", "org.freedesktop.NetworkManager.Settings", "ConnectionRemoved", {QVariant::fromValue(QDBusObjectPath(message.path()))});
+        } else {
+            error(message, "org.freedesktop.DBus.Error.UnknownMethod");
+        }
+    }
+
+    void geoClue(const QDBusMessage &message)
+    {
+        const QString member = message.member();
+
+        if (member == "GetClient" || member == "CreateClient") {
+            reply(message, {QVariant::fromValue(QDBusObjectPath(QString(GEOCLUE_PATH "/Client/%1").arg(++m_nextClient)))});
+        } else if (member == "DeleteClient" || member == "Stop") {
+            reply(message, {});
+        } else if (member == "Start") {
+            const QString client = message.path();
+            reply(message, {});
+
+            // First fix a little after the client starts
+            QTimer::singleShot(2 * m_latency, this, [this, client]() {
+                emitSignal(client, "org.freedesktop.GeoClue2.Client", "LocationUpdated",
+                           {QVariant::fromValue(QDBusObjectPath("/")), QVariant::fromValue(QDBusObjectPath(GEOCLUE_PATH "/Location/1"))});
+            });
+        } else {
+            error(message, "org.freedesktop.DBus.Error.UnknownMethod");
+        }
+    }
+
+    QVariantMap properties(const QString &path, const QString &interface) const
+    {
+        if (path == NM_PATH && interface == NM_SERVICE) {
+            return {{"WirelessEnabled", m_wirelessEnabled}, {"Devices", QVariant::fromValue(devicePaths())}};
+        } else if (path.startsWith(NM_PATH "/Devices/") && interface == "org.freedesktop.NetworkManager.Device") {
+            // Device 0 is ethernet, device 1 Wi-Fi
+            return {{"DeviceType", path.endsWith("/1") ? 2u : 1u}, {"Interface", path.endsWith("/1") ? "wlan0" : "eth0"}};
+        } else if (path == NM_PATH "/Devices/1" && interface == "org.freedesktop.NetworkManager.Device.Wireless") {
+            return {{"AccessPoints", QVariant::fromValue(accessPointPaths())}};
+        } else if (path.startsWith(NM_PATH "/AccessPoint/") && interface == "org.freedesktop.NetworkManager.AccessPoint") {
+            const int id = path.section('/', -1).toInt();
+            return {{"Ssid", QString("ssid-%1").arg(id).toUtf8()}, {"Strength", QVariant::fromValue(uchar(30 + id * 7 % 70))}, {"Frequency", 2412u}};
+        } else if (m_activeStates.contains(path) && interface == "org.freedesktop.NetworkManager.Connection.Active") {
+            return {{"State", m_activeStates.value(path)}, {"Type", "802-11-wireless"}};
+        } else if (path.startsWith(GEOCLUE_PATH "/Location/") && interface == "org.freedesktop.GeoClue2.Location") {
+            return {{"Latitude", 52.52}, {"Longitude", 13.405}, {"Accuracy", 12.0}, {"Altitude", 34.0},
+                    {"Speed", 0.0}, {"Heading", -1.0}, {"Description", ""}};
+        } else if (path.startsWith(GEOCLUE_PATH "/Client/") && interface == "org.freedesktop.GeoClue2.Client") {
+            return {{"Location", QVariant::fromValue(QDBusObjectPath(GEOCLUE_PATH "/Location/1"))}, {"Active", true},
+                    {"DesktopId", "furios-camera"}, {"DistanceThreshold", 0u}, {"TimeThreshold", 0u}, {"RequestedAccuracyLevel", 8u}};
+        }
+
+        return {};
+    }
+
+    QList<QDBusObjectPath> devicePaths() const
+    {
+        return {QDBusObjectPath(NM_PATH "/Devices/0"), QDBusObjectPath(NM_PATH "/Devices/1")};
+    }
+
+    QList<QDBusObjectPath> accessPointPaths() const
+    {
+        QList<QDBusObjectPath> paths;
+        for (int i = 0; i < m_accessPoints; i++)
+            paths << QDBusObjectPath(QString(NM_PATH "/AccessPoint/%1").arg(i));
+        return paths;
+    }
+
+    void reply(const QDBusMessage &message, const QVariantList &args)
+    {
+        m_bus.send(message.createReply(args));
+    }
+
+    void error(const QDBusMessage &message, const QString &name)
+    {
+        m_bus.send(message.createErrorReply(name, message.interface() + "." + message.member() + " on " + message.path()));
+    }
+
+    void emitSignal(const QString &path, const QString &interface, const QString &name, const QVariantList &args)
+    {
+        QDBusMessage signal = QDBusMessage::createSignal(path, interface, name);
+        signal.setArguments(args);
+        m_bus.send(signal);
+    }
+
+    int m_accessPoints;
+    int m_latency;
+    int m_nextConnection;
+    int m_nextActive;
+    int m_nextClient;
+    bool m_wirelessEnabled;
+    QMap<int, QString> m_connections;
+    QHash<QString, uint> m_activeStates;
+    QDBusConnection m_bus;
+    std::atomic<uint> m_networkManagerCalls{0};
+    std::atomic<uint> m_geoClueCalls{0};
+    std::atomic<uint> m_introspections{0};
+};
+
+static int serveMocks(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+
+    qDBusRegisterMetaType<ConnectionSettings>();
+
+    MockServices mock(args.value(2).toInt(), args.value(3).toInt(), args.value(4).toInt());
+    QDBusConnection bus = QDBusConnection::systemBus();
+
+    if (!bus.registerVirtualObject("/org/freedesktop", &mock, QDBusConnection::SubPath) ||
+        !bus.registerService(NM_SERVICE) || !bus.registerService(GEOCLUE_SERVICE)) {
+        qWarning() << "Can't register the mock services:" << bus.lastError().message();
+        return 1;
+    }
+
+    return app.exec();
+}
+
+static CallStats controlCall(const QString &member)
+{
+    const QDBusMessage reply = QDBusConnection::systemBus().call(
+        QDBusMessage::createMethodCall(NM_SERVICE, CONTROL_PATH, CONTROL_INTERFACE, member));
+
+    CallStats stats;
+    stats.networkManager = reply.arguments().value(0).toUInt();
+    stats.geoClue = reply.arguments().value(1).toUInt();
+    stats.introspections = reply.arguments().value(2).toUInt();
+    return stats;
+}
+
+static void sleepEventLoop(int ms)
+{
+    QEventLoop loop;
+    QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+// Background loading started by the previous step must not be counted in the next
+static void waitForIdle(int latency)
+{
+    const int interval = std::max(50, 4 * latency);
+    uint last = ~0u;
+
+    for (int i = 0; i < 100; i++) {
+        const CallStats stats = controlCall("Stats");
+        const uint total = stats.networkManager + stats.geoClue + stats.introspections;
+        if (total == last)
+            return;
+        last = total;
+        sleepEventLoop(interval);
+    }
+}
+
+template <typename Func>
+static bool waitUntil(std::function<bool()> done, const typename QtPrivate::FunctionPointer<Func>::Object *sender, Func signal, int timeout = 10000)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!done()) {
+        const int left = timeout - timer.elapsed();
+        if (left <= 0)
+            return false;
+
+        QEventLoop loop;
+        QTimer::singleShot(left, &loop, &QEventLoop::quit);
+        QObject::connect(sender, signal, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    return true;
+}
+
+struct Benchmark {
+    QString name;
+    std::function<void()> setup;
+    std::function<bool()> run;
+    std::function<void()> teardown;
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && qstrcmp(argv[1], "--serve-mocks") == 0)
+        return serveMocks(argc, argv);
+
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("dbus-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the camera's NetworkManager and GeoClue calls against stand-in services");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"access-points", "Access points the Wi-Fi device sees.", "count", "40"},
+        {"connections", "Saved connection profiles.", "count", "200"},
+        {"latency", "Delay before the services answer each call (ms).", "ms", "2"},
+        {"runs", "Runs of each operation.", "count", "10"},
+        {"dbus-daemon", "dbus-daemon binary to start.", "path", "dbus-daemon"},
+    });
+    parser.process(app);
+
+    const int latency = parser.value("latency").toInt();
+    const int runs = std::max(1, parser.value("runs").toInt());
+
+    QProcess daemon;
+    daemon.start(parser.value("dbus-daemon"), {"--session", "--nofork", "--print-address=1"});
+    if (!daemon.waitForStarted() || !daemon.waitForReadyRead(5000)) {
+        fprintf(stderr, "Can't start %s\n", qPrintable(parser.value("dbus-daemon")));
+        return 1;
+    }
+
+    // Everything below talks to the private bus as if it was the system bus
+    const QByteArray address = daemon.readLine().trimmed();
+    qputenv("DBUS_SYSTEM_BUS_ADDRESS", address);
+
+    QProcess services;
+    services.setProcessChannelMode(QProcess::ForwardedChannels);
+    services.start(app.applicationFilePath(), {"--serve-mocks", parser.value("access-points"), parser.value("connections"), QString::number(latency)});
+
+    QDBusConnectionInterface *bus = QDBusConnection::systemBus().interface();
+    for (int i = 0; i < 100 && !(bus->isServiceRegistered(NM_SERVICE) && bus->isServiceRegistered(GEOCLUE_SERVICE)); i++)
+        QThread::msleep(50);
+
+    if (!bus->isServiceRegistered(NM_SERVICE)) {
+        fprintf(stderr, "Mock services did not come up\n");
+        return 1;
+    }
+
+    const QString wifiCode = "WIFI:T:WPA;S:" JOIN_SSID ";P:secret;;";
+    QRCodeHandler *handler = nullptr;
+
+    auto iconResolved = [&handler]() {
+        return handler->getSignalStrengthIcon() != OFFLINE_SIGNAL && handler->getSignalStrengthIcon() != NO_ROUTE_SIGNAL;
+    };
+
+    auto joinFinished = [&handler]() {
+        return handler->getJoinState() == "connected" || handler->getJoinState() == "failed";
+    };
+
+    auto createHandler = [&handler, &wifiCode]() {
+        handler = new QRCodeHandler();
+        handler->parseQrString(wifiCode);
+    };
+
+    auto deleteHandler = [&handler]() {
+        delete handler;
+        handler = nullptr;
+    };
+
+    GeoClueFind *gps = nullptr;
+    bool located = false;
+
+    const QList<Benchmark> benchmarks = {
+        {"signal icon (cold)", nullptr, [&]() {
+            createHandler();
+            return waitUntil(iconResolved, handler, &QRCodeHandler::signalChanged);
+        }, deleteHandler},
+        {"signal icon (warm) x100", [&]() {
+            createHandler();
+            waitUntil(iconResolved, handler, &QRCodeHandler::signalChanged);
+        }, [&]() {
+            for (int i = 0; i < 100; i++)
+                handler->getSignalStrengthIcon();
+            return iconResolved();
+        }, deleteHandler},
+        {"join Wi-Fi from QR (cold)", nullptr, [&]() {
+            createHandler();
+            handler->connectToWifi();
+            return waitUntil(joinFinished, handler, &QRCodeHandler::joinStateChanged) && handler->getJoinState() == "connected";
+        }, deleteHandler},
+        {"join Wi-Fi from QR (warm)", createHandler, [&]() {
+            handler->parseQrString(wifiCode);
+            handler->connectToWifi();
+            return waitUntil(joinFinished, handler, &QRCodeHandler::joinStateChanged) && handler->getJoinState() == "connected";
+        }, deleteHandler},
+        {"GPS client handshake", nullptr, [&]() {
+            bool started = false;
+            gps = new GeoClueFind();
+            QObject::connect(gps, &GeoClueFind::ready, [&started]() { started = true; });
+            return waitUntil([&started]() { return started; }, gps, &GeoClueFind::ready);
+        }, [&]() {
+            gps->stopClient();
+            delete gps;
+            gps = nullptr;
+        }},
+        {"start GPS", nullptr, [&]() {
+            located = false;
+            gps = new GeoClueFind();
+            QObject::connect(gps, &GeoClueFind::locationUpdated, [&located]() { located = true; });
+            return waitUntil([&located]() { return located; }, gps, &GeoClueFind::locationUpdated);
+        }, [&]() {
+            gps->stopClient();
+            delete gps;
+            gps = nullptr;
+        }},
+        {"resume GPS", [&]() {
+            located = false;
+            gps = new GeoClueFind();
+            QObject::connect(gps, &GeoClueFind::locationUpdated, [&located]() { located = true; });
+            waitUntil([&located]() { return located; }, gps, &GeoClueFind::locationUpdated);
+            gps->pauseClient();
+        }, [&]() {
+            located = false;
+            gps->resumeClient();
+            return waitUntil([&located]() { return located; }, gps, &GeoClueFind::locationUpdated);
+        }, [&]() {
+            gps->stopClient();
+            delete gps;
+            gps = nullptr;
+        }},
+    };
+
+    printf("%d access points, %d saved connections, %d ms per call\n\n",
+           parser.value("access-points").toInt(), parser.value("connections").toInt(), latency);
+    printf("%-26s %5s %9s %9s %9s %8s %8s %8s\n", "operation", "runs", "mean ms", "min ms", "max ms", "nm", "geoclue", "introsp");
+
+    int failures = 0;
+
+    for (const Benchmark &benchmark : benchmarks) {
+        double totalMs = 0;
+        double minMs = 1e9;
+        double maxMs = 0;
+        CallStats calls;
+
+        for (int i = 0; i < runs; i++) {
+            if (benchmark.setup)
+                benchmark.setup();
+
+            waitForIdle(latency);
+            controlCall("Reset");
+
+            QElapsedTimer timer;
+            timer.start();
+            const bool ok = benchmark.run();
+            const double ms = timer.nsecsElapsed() / 1e6;
+
+            if (!ok) {
+                fprintf(stderr, "%s: run %d did not finish\n", qPrintable(benchmark.name), i + 1);
+                failures++;
+            }
+
+            const CallStats stats = controlCall("Stats");
+            calls.networkManager += stats.networkManager;
+            calls.geoClue += stats.geoClue;
+            calls.introspections += stats.introspections;
+
+            totalMs += ms;
+            minMs = std::min(minMs, ms);
+            maxMs = std::max(maxMs, ms);
+
+            if (benchmark.teardown)
+                benchmark.teardown();
+        }
+
+        printf("%-26s %5d %9.2f %9.2f %9.2f %8.1f %8.1f %8.1f\n", qPrintable(benchmark.name), runs,
+               totalMs / runs, minMs, maxMs, double(calls.networkManager) / runs, double(calls.geoClue) / runs,
+               double(calls.introspections) / runs);
+    }
+
+    services.terminate();
+    services.waitForFinished();
+    daemon.terminate();
+    daemon.waitForFinished();
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+//
+// Cold and warm start benchmark. Launches the camera repeatedly with the startup
+// timeline enabled and a test pattern in place of the camera, waits for the
+// first viewfinder frame, and reports percentiles for every milestone measured
+// from the moment the process was spawned, and for the peak RSS at that point.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef CAMERA_BINARY
+#define CAMERA_BINARY "furios-camera"
+#endif
+
+// In the order the camera reaches them
+static const QStringList MILESTONES = {
+    "main", "singleInstanceListen", "appControllerInitialize", "engineLoaded", "settingsLoaded",
+    "windowExposed", "gpsInit", "cameraActive", "firstVideoFrame",
+};
+
+static const QString PEAK_RSS = "peakRss";
+
+static qint64 monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static QJsonObject readTimeline(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+static bool hasMilestone(const QJsonObject &timeline, const QString &name)
+{
+    for (const QJsonValue &milestone : timeline.value("milestones").toArray()) {
+        if (milestone.toObject().value("name").toString() == name)
+            return true;
+    }
+    return false;
+}
+
+// VmHWM of a running process in MiB, -1 once it is gone
+static double peakRssMiB(qint64 pid)
+{
+    QFile status(QString("/proc/%1/status").arg(pid));
+    if (!status.open(QIODevice::ReadOnly))
+        return -1;
+
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong() / 1024.0;
+    }
+    return -1;
+}
+
+static bool dropPageCache()
+{
+    sync();
+
+    QFile dropCaches("/proc/sys/vm/drop_caches");
+    return dropCaches.open(QIODevice::WriteOnly) && dropCaches.write("3\n") == 2;
+}
+
+// Milestone name to ms since spawn, plus PEAK_RSS in MiB, empty when the run did not reach the first frame
+static QMap<QString, double> launch(const QString &binary, const QString &workDir, const QString &cacheDir,
+                                    const QString &busAddress, const QString &videoSource, int timeoutMs, int run)
+{
+    const QString logPath = QString("%1/timeline-%2.json").arg(workDir).arg(run);
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("FURIOS_CAMERA_STARTUP_LOG", logPath);
+    environment.insert("QT_GSTREAMER_CAMERABIN_VIDEOSRC", videoSource);
+    environment.insert("XDG_CACHE_HOME", cacheDir);
+    // A camera that is already running owns the bus name on the user's session
+    // bus, and every launch would hand over to it and exit
+    environment.insert("DBUS_SESSION_BUS_ADDRESS", busAddress);
+    // Same for its local socket, used when there is no session bus
+    environment.insert("TMPDIR", workDir);
+
+    QProcess camera;
+    camera.setProcessEnvironment(environment);
+    camera.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    camera.setStandardOutputFile(QProcess::nullDevice());
+
+    const qint64 spawned = monotonicNs();
+    camera.start(binary, QStringList());
+
+    QMap<QString, double> result;
+    QElapsedTimer waited;
+    waited.start();
+
+    while (waited.elapsed() < timeoutMs && camera.state() != QProcess::NotRunning) {
+        const QJsonObject timeline = readTimeline(logPath);
+
+        if (hasMilestone(timeline, "firstVideoFrame")) {
+            for (const QJsonValue &value : timeline.value("milestones").toArray()) {
+                const QJsonObject milestone = value.toObject();
+                result.insert(milestone.value("name").toString(), (milestone.value("monotonicNs").toVariant().toLongLong() - spawned) / 1e6);
+            }
+
+            const double rss = peakRssMiB(camera.processId());
+            if (rss >= 0)
+                result.insert(PEAK_RSS, rss);
+            break;
+        }
+
+        QThread::msleep(5);
+    }
+
+    camera.terminate();
+    if (!camera.waitForFinished(3000)) {
+        camera.kill();
+        camera.waitForFinished();
+    }
+
+    return result;
+}
+
+static double percentile(QVector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    const int index = qBound(0, int(p * values.size() + 0.5) - 1, values.size() - 1);
+    return values[index];
+}
+
+static void report(const QString &title, const QList<QMap<QString, double>> &runs)
+{
+    printf("\n%s, %d runs\n", qPrintable(title), runs.size());
+    printf("%-24s %9s %9s %9s %9s\n", "milestone", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    for (const QString &name : MILESTONES + QStringList(PEAK_RSS)) {
+        if (name == PEAK_RSS)
+            printf("%-24s %9s %9s %9s %9s\n", "", "p50 MiB", "p90 MiB", "p99 MiB", "max MiB");
+
+        QVector<double> values;
+        for (const QMap<QString, double> &run : runs) {
+            if (run.contains(name))
+                values.append(run.value(name));
+        }
+
+        if (values.isEmpty()) {
+            printf("%-24s %9s\n", qPrintable(name), "-");
+            continue;
+        }
+
+        printf("%-24s %9.1f %9.1f %9.1f %9.1f\n", qPrintable(name), percentile(values, 0.5),
+               percentile(values, 0.9), percentile(values, 0.99), *std::max_element(values.begin(), values.end()));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times cold and warm starts of the camera up to the first viewfinder frame");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"binary", "Camera executable to launch", "path", CAMERA_BINARY},
+        {"runs", "Measured starts of each kind", "count", "10"},
+        {"video-source", "GStreamer element used as the camera", "element", "videotestsrc"},
+        {"timeout", "Give up on a start after this many ms", "ms", "30000"},
+        {"drop-caches", "Drop the page cache before every cold start, needs root"},
+        {"dbus-daemon", "dbus-daemon binary to start", "path", "dbus-daemon"},
+    });
+    parser.process(app);
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        fprintf(stderr, "Can't create a working directory\n");
+        return 1;
+    }
+
+    QProcess daemon;
+    daemon.start(parser.value("dbus-daemon"), {"--session", "--nofork", "--print-address=1"});
+    if (!daemon.waitForStarted() || !daemon.waitForReadyRead(5000)) {
+        fprintf(stderr, "Can't start %s\n", qPrintable(parser.value("dbus-daemon")));
+        return 1;
+    }
+
+    // Every launch gets this private session bus, the camera quits between runs
+    // so each one owns the bus name again
+    const QString busAddress = QString::fromUtf8(daemon.readLine().trimmed());
+
+    const QString binary = parser.value("binary");
+    const QString videoSource = parser.value("video-source");
+    const int runs = parser.value("runs").toInt();
+    const int timeoutMs = parser.value("timeout").toInt();
+    const bool dropCaches = parser.isSet("drop-caches");
+    int launches = 0;
+    int failures = 0;
+
+    printf("%s with %s as the camera\n", qPrintable(binary), qPrintable(videoSource));
+
+    // Cold: empty QML and app caches every time, and optionally an empty page cache
+    QList<QMap<QString, double>> cold;
+    for (int i = 0; i < runs; i++) {
+        if (dropCaches && !dropPageCache()) {
+            fprintf(stderr, "Can't drop the page cache, run as root or without --drop-caches\n");
+            return 1;
+        }
+
+        const QString cacheDir = QString("%1/cold-cache-%2").arg(workDir.path()).arg(i);
+        const QMap<QString, double> result = launch(binary, workDir.path(), cacheDir, busAddress, videoSource, timeoutMs, launches++);
+        if (result.isEmpty())
+            failures++;
+        else
+            cold.append(result);
+    }
+
+    // Warm: one unmeasured start fills the caches the measured ones reuse
+    const QString warmCache = workDir.path() + "/warm-cache";
+    launch(binary, workDir.path(), warmCache, busAddress, videoSource, timeoutMs, launches++);
+
+    QList<QMap<QString, double>> warm;
+    for (int i = 0; i < runs; i++) {
+        const QMap<QString, double> result = launch(binary, workDir.path(), warmCache, busAddress, videoSource, timeoutMs, launches++);
+        if (result.isEmpty())
+            failures++;
+        else
+            warm.append(result);
+    }
+
+    report(dropCaches ? "cold start, page cache dropped" : "cold start", cold);
+    report("warm start", warm);
+
+    if (failures > 0)
+        fprintf(stderr, "\n%d starts did not reach the first frame\n", failures);
+
+    daemon.terminate();
+    daemon.waitForFinished();
+
+    return failures == 0 ? 0 : 1;
+}
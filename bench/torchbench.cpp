@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+//
+// Timing benchmark for the torch pattern engine. Builds a fake sysfs tree with
+// torch, switch and thermal files (or uses a real one), plays pulses, strobes and
+// ramps through FlashlightController and reports how late each LED write was
+// against its deadline, then checks that a ramp really changes the LED level and
+// that a hot sensor stops a running pattern.
+
+#include "flashlightcontroller.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <cstdio>
+#include <functional>
+
+static bool writeFile(const QString &path, const QByteArray &contents)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(contents) == contents.size();
+}
+
+static bool createFakeSysfs(const QString &root)
+{
+    return writeFile(root + "/class/leds/torch-light0/brightness", "0")
+        && writeFile(root + "/class/leds/torch-light0/max_brightness", "255")
+        && writeFile(root + "/class/leds/led:switch/brightness", "0")
+        && writeFile(root + "/class/leds/led:flash_0/brightness", "0")
+        && writeFile(root + "/class/thermal/thermal_zone0/type", "cpu-0-0\n")
+        && writeFile(root + "/class/thermal/thermal_zone0/temp", "45000\n")
+        && writeFile(root + "/class/thermal/thermal_zone1/type", "battery\n")
+        && writeFile(root + "/class/thermal/thermal_zone1/temp", "30000\n");
+}
+
+// Runs the pattern started by play and returns the reason it finished, the GUI
+// thread is kept busy in slices of busyMs to show the writes do not depend on it
+static QString runPattern(FlashlightController &torch, std::function<void()> play, int busyMs)
+{
+    QString reason;
+    QEventLoop loop;
+    QObject::connect(&torch, &FlashlightController::patternFinished, &loop, [&](const QString &finished) {
+        reason = finished;
+        loop.quit();
+    });
+
+    QTimer busy;
+    if (busyMs > 0) {
+        QObject::connect(&busy, &QTimer::timeout, [busyMs]() {
+            QElapsedTimer spin;
+            spin.start();
+            while (spin.elapsed() < busyMs) {}
+        });
+        busy.start(0);
+    }
+
+    play();
+    loop.exec();
+    return reason;
+}
+
+static void printRow(const QString &name, const QString &reason, const TorchPatternEngine::Stats &stats)
+{
+    printf("%-22s %-8s %7llu %10.1f %10.1f %7llu\n", qPrintable(name), qPrintable(reason),
+           (unsigned long long)stats.steps, stats.meanLatenessNs / 1e3, stats.maxLatenessNs / 1e3,
+           (unsigned long long)stats.missed);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the timing of the torch pattern engine against a fake sysfs tree");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"sysfs-root", "Use an existing sysfs tree instead of a temporary fake one, /sys drives the real LEDs", "path"},
+        {"duration", "Length of each strobe and ramp in ms", "ms", "2000"},
+        {"busy-gui", "Keep the GUI thread busy in slices of this many ms while patterns play", "ms", "0"},
+    });
+    parser.process(app);
+
+    QTemporaryDir fakeRoot;
+    QString root = parser.value("sysfs-root");
+
+    if (root.isEmpty()) {
+        if (!fakeRoot.isValid() || !createFakeSysfs(fakeRoot.path())) {
+            fprintf(stderr, "Can't create the fake sysfs tree\n");
+            return 1;
+        }
+        root = fakeRoot.path();
+    }
+
+    const int duration = parser.value("duration").toInt();
+    const int busyMs = parser.value("busy-gui").toInt();
+
+    FlashlightController torch(nullptr, root);
+    if (torch.ledPaths().isEmpty()) {
+        fprintf(stderr, "No torch LEDs under %s\n", qPrintable(root));
+        return 1;
+    }
+
+    printf("%d LEDs under %s, GUI thread busy %d ms at a time\n\n", torch.ledPaths().size(), qPrintable(root), busyMs);
+    printf("%-22s %-8s %7s %10s %10s %7s\n", "pattern", "reason", "steps", "mean us", "max us", "missed");
+
+    int failures = 0;
+
+    struct Run {
+        QString name;
+        QString expected;
+        std::function<void()> play;
+    };
+
+    const QList<Run> runs = {
+        {"pulse 50 ms", "done", [&]() { torch.pulse(50); }},
+        {"strobe 5 Hz", "done", [&]() { torch.strobe(5, duration); }},
+        {"strobe 20 Hz", "done", [&]() { torch.strobe(20, duration); }},
+        {"strobe 50 Hz", "done", [&]() { torch.strobe(50, duration); }},
+        {"strobe 100 Hz", "done", [&]() { torch.strobe(100, duration); }},
+        {"ramp 0-1, held", "timeout", [&]() { torch.ramp(0, 1, duration, duration + 200); }},
+        {"strobe 20 Hz, timeout", "timeout", [&]() { torch.strobe(20, 0, duration / 2); }},
+    };
+
+    for (const Run &run : runs) {
+        const QString reason = runPattern(torch, run.play, busyMs);
+        printRow(run.name, reason, torch.patternStats());
+
+        if (reason != run.expected) {
+            fprintf(stderr, "%s: finished with %s, expected %s\n", qPrintable(run.name), qPrintable(reason), qPrintable(run.expected));
+            failures++;
+        }
+    }
+
+    // The sensor is only ours to heat up in the fake tree
+    if (parser.value("sysfs-root").isEmpty()) {
+        // A ramp stuck on one or two levels still finishes with the right reason
+        const QString torchFile = root + "/class/leds/torch-light0/brightness";
+        QSet<QByteArray> levels;
+        QTimer sampler;
+        QObject::connect(&sampler, &QTimer::timeout, [&]() {
+            QFile file(torchFile);
+            if (file.open(QIODevice::ReadOnly))
+                levels.insert(file.readAll());
+        });
+
+        sampler.start(10);
+        runPattern(torch, [&]() { torch.ramp(0, 1, duration, duration + 200); }, busyMs);
+        sampler.stop();
+
+        if (levels.size() <= 2) {
+            fprintf(stderr, "ramp 0-1: the LED level did not follow the ramp\n");
+            failures++;
+        }
+
+        const QString sensor = root + "/class/thermal/thermal_zone1/temp";
+        QElapsedTimer sinceHot;
+
+        const QString reason = runPattern(torch, [&]() {
+            torch.strobe(20, 0, 60000);
+            QTimer::singleShot(300, [&]() {
+                writeFile(sensor, "75000\n");
+                sinceHot.start();
+            });
+        }, busyMs);
+
+        printRow("strobe 20 Hz, hot", reason, torch.patternStats());
+        printf("\nstopped %lld ms after the sensor went over the limit\n", sinceHot.isValid() ? sinceHot.elapsed() : -1LL);
+        printf("ramp 0-1 wrote %d different levels\n", levels.size());
+        writeFile(sensor, "30000\n");
+
+        if (reason != "thermal") {
+            fprintf(stderr, "hot sensor: finished with %s, expected thermal\n", qPrintable(reason));
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -10,16 +10,39 @@
 #include "thumbnailgenerator.h"
 #include "qrcodehandler.h"
 #include "settingsmanager.h"
+#include "inventoryscanner.h"
+#include "barcodeindexer.h"
 #include "zxingreader.h"
+#include "startuptimeline.h"
+#include "memorypressuremonitor.h"
+#include "cameracontroladaptor.h"
+#include "iconcache.h"
+#include "singleinstance.h"
 #include <QQmlContext>
+#include <QQmlEngine>
 #include <QQuickItem>
 #include <QCamera>
+#include <QCameraInfo>
+#include <QDBusConnection>
+#include <QFileInfo>
+#include <QMediaPlayer>
+#include <QStandardPaths>
+#include <QTimer>
 
-AppController::AppController(QApplication& app)
+// From the request to the saved file, covers starting a stopped camera
+#define REMOTE_CAPTURE_TIMEOUT 10000
+
+AppController::AppController(QGuiApplication& app)
     : m_app(app), m_engine(nullptr), m_window(nullptr),
       m_flashlightController(nullptr), m_fileManager(nullptr),
-      m_thumbnailGenerator(nullptr), m_qrCodeHandler(nullptr)
+      m_thumbnailGenerator(nullptr), m_qrCodeHandler(nullptr),
+      m_inventoryScanner(nullptr), m_barcodeIndexer(nullptr),
+      m_standbyTimer(new QTimer(this)), m_memoryPressure(new MemoryPressureMonitor(this)),
+      m_nextCaptureId(1), m_cameraHooked(false), m_recordingStartMs(-1)
 {
+    m_standbyTimer->setSingleShot(true);
+    connect(m_standbyTimer, &QTimer::timeout, this, &AppController::releaseCamera);
+    connect(m_memoryPressure, &MemoryPressureMonitor::pressure, this, &AppController::releaseCamera);
 }
 
 AppController::~AppController()
@@ -29,27 +52,40 @@ AppController::~AppController()
     delete m_fileManager;
     delete m_thumbnailGenerator;
     delete m_qrCodeHandler;
+    delete m_inventoryScanner;
+    delete m_barcodeIndexer;
 }
 
 void AppController::initialize()
 {
+    StartupTimeline::instance().mark("appControllerInitialize");
     m_engine = new QQmlApplicationEngine();
     setupEngine();
     loadMainWindow();
+
+    // Below the object SingleInstance serves org.freedesktop.Application on, under the same name
+    new CameraControlAdaptor(this);
+    if (!QDBusConnection::sessionBus().registerObject(CAMERA_CONTROL_DBUS_PATH, this)) {
+        qDebug() << "Can't export the camera control interface";
+    }
 }
 
 void AppController::hideWindow()
 {
     if (m_window) {
-        // The camera is already unloaded in QML before this slot is called
-        m_fileManager->turnOffGps();
+        // The camera is already stopped in QML before this slot is called
+        if (m_fileManager) {
+            m_fileManager->pauseGps();
+        }
         m_window->hide();
+        enterStandby();
     }
 }
 
 void AppController::showWindow()
 {
     if (m_window) {
+        leaveStandby();
         loadCamera(); // Before showing window, load back the camera
 
         AppController::restartGpsIfNeeded();
@@ -59,9 +95,23 @@ void AppController::showWindow()
     }
 }
 
+QObject* AppController::rootObject()
+{
+    if (!m_engine || m_engine->rootObjects().isEmpty()) {
+        return nullptr;
+    }
+
+    return m_engine->rootObjects().first();
+}
+
+QObject* AppController::camera()
+{
+    QObject *root = rootObject();
+    return root ? root->findChild<QObject*>("camera") : nullptr;
+}
+
 void AppController::loadCamera() {
-    QObject *rootObject = m_engine->rootObjects().first();
-    QObject *camera = rootObject->findChild<QObject*>("camera");
+    QObject *camera = AppController::camera();
 
     if (camera) {
         camera->setProperty("cameraState", QCamera::ActiveState);
@@ -69,6 +119,53 @@ void AppController::loadCamera() {
     }
 }
 
+void AppController::activateAction(const QString &action, const QVariant &parameter)
+{
+    QObject *root = rootObject();
+    if (!root) {
+        return;
+    }
+
+    QMetaObject::invokeMethod(root, "applyIntent",
+                              Q_ARG(QVariant, action), Q_ARG(QVariant, parameter));
+}
+
+void AppController::enterStandby()
+{
+    // Stopped leaves the camera loaded with its pipeline in READY, so coming
+    // back within the timeout only has to start streaming again
+    const int timeout = SettingsManager::instance().standbyTimeout();
+    if (timeout <= 0) {
+        releaseCamera();
+        return;
+    }
+
+    m_standbyTimer->start(timeout * 1000);
+    m_memoryPressure->start();
+}
+
+void AppController::leaveStandby()
+{
+    m_standbyTimer->stop();
+    m_memoryPressure->stop();
+}
+
+void AppController::releaseCamera()
+{
+    leaveStandby();
+
+    // Shown again before the timer or the pressure event was handled
+    if (m_window && m_window->isVisible()) {
+        return;
+    }
+
+    QObject *camera = AppController::camera();
+    if (camera) {
+        camera->setProperty("cameraState", QCamera::UnloadedState);
+        qDebug() << "Camera released after standby";
+    }
+}
+
 void AppController::initializeSettings()
 {
     if (m_engine) {
@@ -78,34 +175,439 @@ void AppController::initializeSettings()
 
 void AppController::createDirectories()
 {
-    if (m_fileManager) {
-        m_fileManager->createDirectory(QString("/Pictures/furios-camera"));
-        m_fileManager->createDirectory(QString("/Videos/furios-camera"));
-    }
+    fileManager()->createDirectory(QString("/Pictures/furios-camera"));
+    fileManager()->createDirectory(QString("/Videos/furios-camera"));
+
+    QString homePath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    barcodeIndexer()->start(homePath + "/Pictures/furios-camera");
 }
 
 void AppController::restartGpsIfNeeded()
 {
-    if (m_fileManager && SettingsManager::instance().gpsOn()) {
-        m_fileManager->restartGps();
+    if (SettingsManager::instance().gpsOn()) {
+        fileManager()->restartGps();
+    }
+}
+
+QObject* AppController::imageCapture()
+{
+    QObject *camera = AppController::camera();
+    return camera ? camera->property("imageCapture").value<QObject*>() : nullptr;
+}
+
+QObject* AppController::videoRecorder()
+{
+    QObject *root = rootObject();
+    return root ? root->property("cam").value<QObject*>() : nullptr;
+}
+
+bool AppController::hookCamera()
+{
+    if (m_cameraHooked) {
+        return true;
+    }
+
+    QObject *camera = AppController::camera();
+    QObject *capture = imageCapture();
+    QObject *recorder = videoRecorder();
+    if (!camera || !capture || !recorder) {
+        return false;
+    }
+
+    // The QML types only have string based signals, a name that does not match
+    // fails at runtime, so every connection is checked
+    const bool connected =
+        connect(camera, SIGNAL(cameraStatusChanged()), this, SLOT(onCameraStatusChanged()))
+        && connect(capture, SIGNAL(readyForCaptureChanged(bool)), this, SLOT(onCameraStatusChanged()))
+        && connect(capture, SIGNAL(imageCaptured(int,QString)), this, SLOT(onImageCaptured(int,QString)))
+        && connect(capture, SIGNAL(imageSaved(int,QString)), this, SLOT(onImageSaved(int,QString)))
+        && connect(capture, SIGNAL(captureFailed(int,QString)), this, SLOT(onCaptureFailed(int,QString)))
+        && connect(recorder, SIGNAL(playbackStateChanged()), this, SLOT(onRecorderStateChanged()));
+
+    if (!connected) {
+        qDebug() << "Can't follow the camera for remote control";
+        disconnect(camera, nullptr, this, nullptr);
+        disconnect(capture, nullptr, this, nullptr);
+        disconnect(recorder, nullptr, this, nullptr);
+        return false;
+    }
+
+    m_cameraHooked = true;
+    return true;
+}
+
+int AppController::capturePhoto(const QString &path, QString *error)
+{
+    QObject *root = rootObject();
+    if (!root) {
+        *error = "The camera window is not loaded yet";
+        return -1;
+    }
+    if (root->property("videoCaptured").toBool()) {
+        *error = "The camera is recording";
+        return -1;
+    }
+    if (!hookCamera()) {
+        *error = "The camera is not available";
+        return -1;
+    }
+
+    RemoteCapture capture;
+    capture.id = m_nextCaptureId++;
+    capture.path = path;
+    capture.requestId = -1;
+    capture.activeMs = -1;
+    capture.capturedMs = -1;
+    capture.requested.start();
+    m_remoteCaptures.append(capture);
+
+    // Hidden windows keep the camera stopped, captures need it streaming
+    leaveStandby();
+    loadCamera();
+    issuePendingCaptures();
+
+    const int id = capture.id;
+    QTimer::singleShot(REMOTE_CAPTURE_TIMEOUT, this, [this, id]() { onCaptureTimeout(id); });
+
+    return id;
+}
+
+void AppController::onCaptureTimeout(int id)
+{
+    // Usually it was saved or failed long before
+    for (int i = 0; i < m_remoteCaptures.size(); i++) {
+        if (m_remoteCaptures.at(i).id == id) {
+            m_remoteCaptures.removeAt(i);
+            emit captureFailed(id, "Timed out");
+            break;
+        }
+    }
+
+    issuePendingCaptures();
+    returnToStandbyIfIdle();
+}
+
+void AppController::issuePendingCaptures()
+{
+    QObject *camera = AppController::camera();
+    QObject *capture = imageCapture();
+    if (!camera || !capture) {
+        return;
+    }
+
+    if (camera->property("cameraStatus").toInt() != QCamera::ActiveStatus || !capture->property("ready").toBool()) {
+        return;
+    }
+
+    for (RemoteCapture &pending : m_remoteCaptures) {
+        if (pending.requestId >= 0) {
+            continue;
+        }
+
+        pending.activeMs = pending.requested.elapsed();
+
+        int requestId = -1;
+        if (pending.path.isEmpty()) {
+            QMetaObject::invokeMethod(capture, "capture", Q_RETURN_ARG(int, requestId));
+        } else {
+            QMetaObject::invokeMethod(capture, "captureToLocation", Q_RETURN_ARG(int, requestId), Q_ARG(QString, pending.path));
+        }
+        pending.requestId = requestId;
+
+        // One at a time, the next one goes once the camera is ready again
+        break;
+    }
+}
+
+void AppController::onCameraStatusChanged()
+{
+    issuePendingCaptures();
+}
+
+void AppController::onImageCaptured(int requestId, const QString &preview)
+{
+    Q_UNUSED(preview);
+
+    for (RemoteCapture &pending : m_remoteCaptures) {
+        if (pending.requestId == requestId) {
+            pending.capturedMs = pending.requested.elapsed();
+            break;
+        }
+    }
+}
+
+void AppController::onImageSaved(int requestId, const QString &path)
+{
+    for (int i = 0; i < m_remoteCaptures.size(); i++) {
+        const RemoteCapture &pending = m_remoteCaptures.at(i);
+        if (pending.requestId != requestId) {
+            continue;
+        }
+
+        const qint64 totalMs = pending.requested.elapsed();
+        const qint64 capturedMs = pending.capturedMs >= 0 ? pending.capturedMs : totalMs;
+
+        QVariantMap timings;
+        timings.insert("activateMs", pending.activeMs);
+        timings.insert("captureMs", capturedMs - pending.activeMs);
+        timings.insert("saveMs", totalMs - capturedMs);
+        timings.insert("totalMs", totalMs);
+
+        const int id = pending.id;
+        m_remoteCaptures.removeAt(i);
+        emit captureSaved(id, path, timings);
+        break;
+    }
+
+    issuePendingCaptures();
+    returnToStandbyIfIdle();
+}
+
+void AppController::onCaptureFailed(int requestId, const QString &message)
+{
+    for (int i = 0; i < m_remoteCaptures.size(); i++) {
+        if (m_remoteCaptures.at(i).requestId == requestId) {
+            const int id = m_remoteCaptures.at(i).id;
+            m_remoteCaptures.removeAt(i);
+            emit captureFailed(id, message);
+            break;
+        }
+    }
+
+    issuePendingCaptures();
+    returnToStandbyIfIdle();
+}
+
+QString AppController::startRecording()
+{
+    QObject *root = rootObject();
+    if (!root || root->property("videoCaptured").toBool() || !m_remoteCaptures.isEmpty() || !hookCamera()) {
+        return QString();
+    }
+
+    leaveStandby();
+    m_recordingRequested.start();
+    m_recordingStartMs = -1;
+
+    // Same path as the record button, with the UI in video mode to match
+    activateAction("video", QVariant());
+    QMetaObject::invokeMethod(root, "handleVideoRecording");
+
+    m_recordingPath = videoRecorder()->property("outputPath").toString();
+    return m_recordingPath;
+}
+
+bool AppController::stopRecording()
+{
+    QObject *root = rootObject();
+    if (!root || !root->property("videoCaptured").toBool()) {
+        return false;
+    }
+
+    // Also stops recordings started from the UI
+    m_recordingPath = videoRecorder()->property("outputPath").toString();
+    m_recordingStopRequested.start();
+    QMetaObject::invokeMethod(root, "handleVideoRecording");
+    return true;
+}
+
+void AppController::onRecorderStateChanged()
+{
+    const int state = videoRecorder()->property("playbackState").toInt();
+
+    if (state == QMediaPlayer::PlayingState && m_recordingRequested.isValid()) {
+        m_recordingStartMs = m_recordingRequested.elapsed();
+        m_recordingRequested.invalidate();
+        m_recordingStarted.start();
+    } else if (state == QMediaPlayer::StoppedState && m_recordingStopRequested.isValid()) {
+        QVariantMap timings;
+        if (m_recordingStartMs >= 0) {
+            timings.insert("startMs", m_recordingStartMs);
+        }
+        if (m_recordingStarted.isValid()) {
+            timings.insert("durationMs", m_recordingStarted.elapsed() - m_recordingStopRequested.elapsed());
+        }
+        timings.insert("finalizeMs", m_recordingStopRequested.elapsed());
+        timings.insert("bytes", QFileInfo(m_recordingPath).size());
+
+        m_recordingStopRequested.invalidate();
+        m_recordingStarted.invalidate();
+        m_recordingStartMs = -1;
+
+        emit recordingFinalized(m_recordingPath, timings);
+        returnToStandbyIfIdle();
+    }
+}
+
+bool AppController::setCamera(const QString &deviceId)
+{
+    QObject *root = rootObject();
+    QObject *camera = AppController::camera();
+    if (!root || !camera || root->property("videoCaptured").toBool()) {
+        return false;
+    }
+
+    for (const QCameraInfo &info : QCameraInfo::availableCameras()) {
+        if (info.deviceName() == deviceId) {
+            camera->setProperty("deviceId", deviceId);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QVariantMap AppController::status()
+{
+    QVariantMap status;
+    QObject *root = rootObject();
+    QObject *camera = AppController::camera();
+    QObject *capture = imageCapture();
+
+    status.insert("visible", m_window && m_window->isVisible());
+    status.insert("standby", m_standbyTimer->isActive());
+    status.insert("recording", root && root->property("videoCaptured").toBool());
+    status.insert("pendingCaptures", m_remoteCaptures.size());
+
+    if (camera) {
+        status.insert("deviceId", camera->property("deviceId").toString());
+        status.insert("cameraState", camera->property("cameraState").toInt());
+        status.insert("cameraStatus", camera->property("cameraStatus").toInt());
     }
+    if (capture) {
+        status.insert("readyForCapture", capture->property("ready").toBool());
+    }
+
+    return status;
+}
+
+void AppController::returnToStandbyIfIdle()
+{
+    if (!m_window || m_window->isVisible() || !m_remoteCaptures.isEmpty()) {
+        return;
+    }
+
+    QObject *root = rootObject();
+    if (!root || root->property("videoCaptured").toBool()) {
+        return;
+    }
+
+    // As closing the window does
+    QObject *camera = AppController::camera();
+    if (camera) {
+        QMetaObject::invokeMethod(camera, "stop");
+    }
+    enterStandby();
+}
+
+FlashlightController* AppController::flashlightController()
+{
+    if (!m_flashlightController) {
+        m_flashlightController = new FlashlightController();
+    }
+    return m_flashlightController;
+}
+
+FileManager* AppController::fileManager()
+{
+    if (!m_fileManager) {
+        m_fileManager = new FileManager();
+    }
+    return m_fileManager;
+}
+
+ThumbnailGenerator* AppController::thumbnailGenerator()
+{
+    if (!m_thumbnailGenerator) {
+        m_thumbnailGenerator = new ThumbnailGenerator();
+    }
+    return m_thumbnailGenerator;
+}
+
+QRCodeHandler* AppController::qrCodeHandler()
+{
+    if (!m_qrCodeHandler) {
+        m_qrCodeHandler = new QRCodeHandler();
+    }
+    return m_qrCodeHandler;
+}
+
+InventoryScanner* AppController::inventoryScanner()
+{
+    if (!m_inventoryScanner) {
+        m_inventoryScanner = new InventoryScanner();
+    }
+    return m_inventoryScanner;
+}
+
+BarcodeIndexer* AppController::barcodeIndexer()
+{
+    if (!m_barcodeIndexer) {
+        m_barcodeIndexer = new BarcodeIndexer();
+    }
+    return m_barcodeIndexer;
+}
+
+// QML would otherwise delete the objects with the engine, they are ours
+static QObject* keepOwnership(QObject *object)
+{
+    QQmlEngine::setObjectOwnership(object, QQmlEngine::CppOwnership);
+    return object;
 }
 
 void AppController::setupEngine()
 {
-    m_flashlightController = new FlashlightController();
-    m_fileManager = new FileManager();
-    m_thumbnailGenerator = new ThumbnailGenerator();
-    m_qrCodeHandler = new QRCodeHandler();
+    // Singletons instead of context properties, so each object is only built
+    // once QML first touches it rather than before the first frame
+    qmlRegisterSingletonType<FlashlightController>("FuriOS.Camera", 1, 0, "FlashlightController",
+        [this](QQmlEngine *, QJSEngine *) { return keepOwnership(flashlightController()); });
+    qmlRegisterSingletonType<FileManager>("FuriOS.Camera", 1, 0, "FileManager",
+        [this](QQmlEngine *, QJSEngine *) { return keepOwnership(fileManager()); });
+    qmlRegisterSingletonType<ThumbnailGenerator>("FuriOS.Camera", 1, 0, "ThumbnailGenerator",
+        [this](QQmlEngine *, QJSEngine *) { return keepOwnership(thumbnailGenerator()); });
+    qmlRegisterSingletonType<QRCodeHandler>("FuriOS.Camera", 1, 0, "QRCodeHandler",
+        [this](QQmlEngine *, QJSEngine *) { return keepOwnership(qrCodeHandler()); });
+    qmlRegisterSingletonType<InventoryScanner>("FuriOS.Camera", 1, 0, "InventoryScanner",
+        [this](QQmlEngine *, QJSEngine *) { return keepOwnership(inventoryScanner()); });
+    qmlRegisterSingletonType<BarcodeIndexer>("FuriOS.Camera", 1, 0, "BarcodeIndexer",
+        [this](QQmlEngine *, QJSEngine *) { return keepOwnership(barcodeIndexer()); });
+    qmlRegisterSingletonType<StartupTimeline>("FuriOS.Camera", 1, 0, "StartupTimeline",
+        [](QQmlEngine *, QJSEngine *) { return keepOwnership(&StartupTimeline::instance()); });
+    qmlRegisterType<FirstFrameProbe>("FuriOS.Camera", 1, 0, "FirstFrameProbe");
 
-    m_engine->rootContext()->setContextProperty("flashlightController", m_flashlightController);
-    m_engine->rootContext()->setContextProperty("fileManager", m_fileManager);
-    m_engine->rootContext()->setContextProperty("thumbnailGenerator", m_thumbnailGenerator);
-    m_engine->rootContext()->setContextProperty("QRCodeHandler", m_qrCodeHandler);
+    // The engine owns the provider
+    m_engine->addImageProvider("icons", new IconCache(
+        QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/furios-camera/icons"));
 
     ZXingQt::registerQmlAndMetaTypes();
 }
 
+void AppController::onFirstFrame()
+{
+    // Several frames may already be queued
+    if (!m_firstFrameConnection) {
+        return;
+    }
+    QObject::disconnect(m_firstFrameConnection);
+    m_firstFrameConnection = QMetaObject::Connection();
+
+    // Nothing here is needed to show the viewfinder
+    createDirectories();
+    restartGpsIfNeeded();
+    StartupTimeline::instance().mark("gpsInit");
+}
+
+bool AppController::eventFilter(QObject *watched, QEvent *event)
+{
+    // Only installed on the main window while the startup timeline is recorded
+    if (event->type() == QEvent::Expose && m_window && m_window->isExposed()) {
+        StartupTimeline::instance().mark("windowExposed");
+        watched->removeEventFilter(this);
+    }
+
+    return QObject::eventFilter(watched, event);
+}
+
 void AppController::loadMainWindow()
 {
     const QUrl url(QStringLiteral("qrc:/main.qml"));
@@ -117,9 +619,18 @@ void AppController::loadMainWindow()
             m_window = window;
             window->setFlag(Qt::Window);
 
+            // frameSwapped comes from the render thread
+            m_firstFrameConnection = QObject::connect(window, &QQuickWindow::frameSwapped,
+                                                      this, &AppController::onFirstFrame, Qt::QueuedConnection);
+
             QObject::connect(window, SIGNAL(customClosing()), this, SLOT(hideWindow()));
+
+            if (StartupTimeline::instance().isEnabled()) {
+                window->installEventFilter(this);
+            }
         }
     }, Qt::QueuedConnection);
 
     m_engine->load(url);
+    StartupTimeline::instance().mark("engineLoaded");
 }
@@ -8,21 +8,26 @@
 #define APPCONTROLLER_H
 
 #include <QObject>
-#include <QApplication>
+#include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQuickWindow>
-#include <QSystemTrayIcon>
+#include <QElapsedTimer>
+#include <QVariantMap>
 
 class FlashlightController;
 class FileManager;
 class ThumbnailGenerator;
 class QRCodeHandler;
+class InventoryScanner;
+class BarcodeIndexer;
+class MemoryPressureMonitor;
+class QTimer;
 
 class AppController : public QObject
 {
     Q_OBJECT
 public:
-    explicit AppController(QApplication& app);
+    explicit AppController(QGuiApplication& app);
     ~AppController();
 
     void initialize();
@@ -32,21 +37,91 @@ public:
     void createDirectories();
     void restartGpsIfNeeded();
 
+    // Built on first use, from QML or from here
+    FlashlightController* flashlightController();
+    FileManager* fileManager();
+    ThumbnailGenerator* thumbnailGenerator();
+    QRCodeHandler* qrCodeHandler();
+    InventoryScanner* inventoryScanner();
+    BarcodeIndexer* barcodeIndexer();
+
+    // Remote control through CameraControlAdaptor, works while the window is hidden.
+    // capturePhoto returns -1 with the reason in error, startRecording an empty
+    // path when the camera is busy.
+    int capturePhoto(const QString &path, QString *error);
+    QString startRecording();
+    bool stopRecording();
+    bool setCamera(const QString &deviceId);
+    QVariantMap status();
+
+signals:
+    void captureSaved(int id, const QString &path, const QVariantMap &timings);
+    void captureFailed(int id, const QString &message);
+    void recordingFinalized(const QString &path, const QVariantMap &timings);
+
 public slots:
     void hideWindow();
+    // Switches the UI to the mode asked for at launch, see SingleInstance::parseIntent
+    void activateAction(const QString &action, const QVariant &parameter);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void onFirstFrame();
+    void releaseCamera();
+    void onCameraStatusChanged();
+    void onImageCaptured(int requestId, const QString &preview);
+    void onImageSaved(int requestId, const QString &path);
+    void onCaptureFailed(int requestId, const QString &message);
+    void onCaptureTimeout(int id);
+    void onRecorderStateChanged();
 
 private:
     void setupEngine();
     void loadMainWindow();
+    QObject* rootObject();
+    QObject* camera();
+    void enterStandby();
+    void leaveStandby();
+    QObject* imageCapture();
+    QObject* videoRecorder();
+    bool hookCamera();
+    void issuePendingCaptures();
+    void returnToStandbyIfIdle();
 
-    QApplication& m_app;
+    QGuiApplication& m_app;
     QQmlApplicationEngine* m_engine;
     QQuickWindow* m_window;
-    QSystemTrayIcon* m_trayIcon;
     FlashlightController* m_flashlightController;
     FileManager* m_fileManager;
     ThumbnailGenerator* m_thumbnailGenerator;
     QRCodeHandler* m_qrCodeHandler;
+    InventoryScanner* m_inventoryScanner;
+    BarcodeIndexer* m_barcodeIndexer;
+    QMetaObject::Connection m_firstFrameConnection;
+    // Keeps the camera loaded but stopped for a while after the window is hidden
+    QTimer* m_standbyTimer;
+    MemoryPressureMonitor* m_memoryPressure;
+
+    struct RemoteCapture {
+        int id;
+        QString path;
+        int requestId;
+        QElapsedTimer requested;
+        qint64 activeMs;
+        qint64 capturedMs;
+    };
+
+    QList<RemoteCapture> m_remoteCaptures;
+    int m_nextCaptureId;
+    bool m_cameraHooked;
+    // Set while a recording started over D-Bus is being started or stopped
+    QElapsedTimer m_recordingRequested;
+    QElapsedTimer m_recordingStarted;
+    QElapsedTimer m_recordingStopRequested;
+    qint64 m_recordingStartMs;
+    QString m_recordingPath;
 };
 
 #endif // APPCONTROLLER_H
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "barcodeindexer.h"
+#include "zxingreader.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QDebug>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// Photos are decoded at this size, which still finds the codes someone would
+// search for later while keeping JPEG decoding cheap
+#define INDEX_DECODE_SIZE 1600
+// A capture is written, then rewritten when GPS metadata is appended, so wait
+// for the file to settle before decoding it
+#define SETTLE_INTERVAL 2000
+#define SAVE_INTERVAL 5000
+
+void BarcodeIndexWorker::indexFile(const QString &path) {
+    QFileInfo info(path);
+    if (!info.exists()) {
+        return;
+    }
+
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+
+    const QSize size = reader.size();
+    double scale = 1.0;
+    if (size.isValid() && std::max(size.width(), size.height()) > INDEX_DECODE_SIZE) {
+        const QSize scaled = size.scaled(INDEX_DECODE_SIZE, INDEX_DECODE_SIZE, Qt::KeepAspectRatio);
+        reader.setScaledSize(scaled);
+        scale = double(size.width()) / scaled.width();
+    }
+
+    const QImage image = reader.read().convertToFormat(QImage::Format_Grayscale8);
+    QVariantList codes;
+
+    if (image.isNull()) {
+        qWarning() << "Barcode index: can't read" << path << reader.errorString();
+    } else {
+        for (const ZXingQt::Result &result : ZXingQt::ReadBarcodes(image)) {
+            QVariantList position;
+            for (int i = 0; i < 4; i++) {
+                position << qRound(result.position()[i].x() * scale) << qRound(result.position()[i].y() * scale);
+            }
+
+            codes.append(QVariantMap{
+                {"text", result.text()},
+                {"format", result.formatName()},
+                {"position", position},
+            });
+        }
+    }
+
+    emit fileIndexed(path, info.lastModified().toMSecsSinceEpoch(), codes);
+}
+
+BarcodeIndexer::BarcodeIndexer(QObject *parent) : QObject(parent), m_worker(new BarcodeIndexWorker()), m_notifier(nullptr), m_inotifyFd(-1) {
+    m_indexPath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/furios-camera/barcode-index.json";
+
+    m_settleTimer.setSingleShot(true);
+    m_settleTimer.setInterval(SETTLE_INTERVAL);
+    connect(&m_settleTimer, &QTimer::timeout, this, &BarcodeIndexer::flushPending);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_INTERVAL);
+    connect(&m_saveTimer, &QTimer::timeout, this, &BarcodeIndexer::saveIndex);
+
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(this, &BarcodeIndexer::indexRequested, m_worker, &BarcodeIndexWorker::indexFile);
+    connect(m_worker, &BarcodeIndexWorker::fileIndexed, this, &BarcodeIndexer::onFileIndexed);
+}
+
+BarcodeIndexer::~BarcodeIndexer() {
+    // The worker is only deleted by the thread finishing, which needs start()
+    if (!m_thread.isRunning() && !m_thread.isFinished()) {
+        delete m_worker;
+    }
+
+    m_thread.quit();
+    m_thread.wait();
+
+    if (m_saveTimer.isActive()) {
+        saveIndex();
+    }
+
+    if (m_inotifyFd >= 0) {
+        close(m_inotifyFd);
+    }
+}
+
+void BarcodeIndexer::start(const QString &directory) {
+    if (!m_directory.isEmpty()) {
+        return;
+    }
+
+    m_directory = directory;
+    loadIndex();
+
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0 || inotify_add_watch(m_inotifyFd, QFile::encodeName(m_directory).constData(),
+                                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        qWarning() << "Barcode index: can't watch" << m_directory;
+    } else {
+        m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &BarcodeIndexer::onInotifyEvent);
+    }
+
+    m_thread.start(QThread::IdlePriority);
+
+    // Catch up with whatever changed while we were not running
+    QDir dir(m_directory);
+    const QFileInfoList photos = dir.entryInfoList(QStringList() << "*.jpg", QDir::Files);
+    QSet<QString> present;
+
+    for (const QFileInfo &info : photos) {
+        present.insert(info.fileName());
+        auto entry = m_entries.constFind(info.fileName());
+        if (entry == m_entries.constEnd() || entry->modified != info.lastModified().toMSecsSinceEpoch()) {
+            emit indexRequested(info.absoluteFilePath());
+        }
+    }
+
+    for (const QString &name : m_entries.keys()) {
+        if (!present.contains(name)) {
+            removeFromIndex(name);
+        }
+    }
+}
+
+QStringList BarcodeIndexer::findPhotos(const QString &code) const {
+    // A photo holding the same code twice is listed once per code
+    QStringList names = m_lookup.values(code);
+    names.removeDuplicates();
+    std::sort(names.begin(), names.end(), [this](const QString &a, const QString &b) {
+        return m_entries.value(a).modified < m_entries.value(b).modified;
+    });
+
+    QStringList urls;
+    for (const QString &name : names) {
+        urls.append(QUrl::fromLocalFile(m_directory + "/" + name).toString());
+    }
+    return urls;
+}
+
+QVariantList BarcodeIndexer::codesInPhoto(const QString &fileUrl) const {
+    QString path = QUrl(fileUrl).isLocalFile() ? QUrl(fileUrl).toLocalFile() : fileUrl;
+    return m_entries.value(QFileInfo(path).fileName()).codes;
+}
+
+void BarcodeIndexer::onInotifyEvent() {
+    alignas(struct inotify_event) char buffer[4096];
+
+    while (true) {
+        ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (char *ptr = buffer; ptr < buffer + length; ) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->len == 0) {
+                continue;
+            }
+
+            const QString name = QFile::decodeName(event->name);
+            if (!name.endsWith(".jpg")) {
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                m_pending.remove(name);
+                removeFromIndex(name);
+            } else {
+                queueFile(name);
+            }
+        }
+    }
+}
+
+void BarcodeIndexer::queueFile(const QString &name) {
+    m_pending.insert(name);
+    m_settleTimer.start();
+}
+
+void BarcodeIndexer::flushPending() {
+    for (const QString &name : qAsConst(m_pending)) {
+        emit indexRequested(m_directory + "/" + name);
+    }
+    m_pending.clear();
+}
+
+void BarcodeIndexer::onFileIndexed(const QString &path, qint64 modified, const QVariantList &codes) {
+    const QString name = QFileInfo(path).fileName();
+
+    removeFromIndex(name);
+
+    Entry entry;
+    entry.modified = modified;
+    entry.codes = codes;
+    m_entries.insert(name, entry);
+    addToLookup(name, codes);
+
+    m_saveTimer.start();
+    emit photoIndexed(QUrl::fromLocalFile(path).toString(), codes.size());
+}
+
+void BarcodeIndexer::addToLookup(const QString &name, const QVariantList &codes) {
+    for (const QVariant &code : codes) {
+        m_lookup.insert(code.toMap().value("text").toString(), name);
+    }
+}
+
+void BarcodeIndexer::removeFromIndex(const QString &name) {
+    auto entry = m_entries.find(name);
+    if (entry == m_entries.end()) {
+        return;
+    }
+
+    for (const QVariant &code : entry->codes) {
+        m_lookup.remove(code.toMap().value("text").toString(), name);
+    }
+    m_entries.erase(entry);
+    m_saveTimer.start();
+}
+
+void BarcodeIndexer::loadIndex() {
+    QFile file(m_indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject photos = QJsonDocument::fromJson(file.readAll()).object().value("photos").toObject();
+
+    for (auto it = photos.constBegin(); it != photos.constEnd(); ++it) {
+        const QJsonObject photo = it.value().toObject();
+
+        Entry entry;
+        entry.modified = photo.value("modified").toVariant().toLongLong();
+        entry.codes = photo.value("codes").toArray().toVariantList();
+        m_entries.insert(it.key(), entry);
+        addToLookup(it.key(), entry.codes);
+    }
+}
+
+void BarcodeIndexer::saveIndex() {
+    QJsonObject photos;
+
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        photos.insert(it.key(), QJsonObject{
+            {"modified", it->modified},
+            {"codes", QJsonArray::fromVariantList(it->codes)},
+        });
+    }
+
+    QDir().mkpath(QFileInfo(m_indexPath).absolutePath());
+
+    QSaveFile file(m_indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Barcode index: can't write" << m_indexPath;
+        return;
+    }
+
+    file.write(QJsonDocument(QJsonObject{{"version", 1}, {"photos", photos}}).toJson(QJsonDocument::Compact));
+    file.commit();
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef BARCODEINDEXER_H
+#define BARCODEINDEXER_H
+
+#include <QObject>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <QVariantList>
+
+class QSocketNotifier;
+
+// Decodes photos on an idle priority thread
+class BarcodeIndexWorker : public QObject
+{
+    Q_OBJECT
+public slots:
+    void indexFile(const QString &path);
+
+signals:
+    void fileIndexed(const QString &path, qint64 modified, const QVariantList &codes);
+};
+
+// Keeps a persistent index of the codes visible in the photos we took, so they can
+// be looked up by content without decoding anything at query time. New captures
+// are picked up through inotify, the index is only brought up to date with the
+// directory listing once at start.
+class BarcodeIndexer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BarcodeIndexer(QObject *parent = nullptr);
+    ~BarcodeIndexer();
+
+    void start(const QString &directory);
+
+    // File URLs of the photos containing the given code, oldest first
+    Q_INVOKABLE QStringList findPhotos(const QString &code) const;
+    // Codes found in a photo, each with text, format and position
+    Q_INVOKABLE QVariantList codesInPhoto(const QString &fileUrl) const;
+
+signals:
+    void indexRequested(const QString &path);
+    void photoIndexed(const QString &fileUrl, int count);
+
+private slots:
+    void onInotifyEvent();
+    void onFileIndexed(const QString &path, qint64 modified, const QVariantList &codes);
+    void flushPending();
+    void saveIndex();
+
+private:
+    struct Entry {
+        qint64 modified = 0;
+        QVariantList codes;
+    };
+
+    void loadIndex();
+    void addToLookup(const QString &name, const QVariantList &codes);
+    void removeFromIndex(const QString &name);
+    void queueFile(const QString &name);
+
+    QString m_directory;
+    QString m_indexPath;
+    QHash<QString, Entry> m_entries;
+    QMultiHash<QString, QString> m_lookup;
+    QSet<QString> m_pending;
+    QTimer m_settleTimer;
+    QTimer m_saveTimer;
+    QThread m_thread;
+    BarcodeIndexWorker *m_worker;
+    QSocketNotifier *m_notifier;
+    int m_inotifyFd;
+};
+
+#endif // BARCODEINDEXER_H
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "cameracontroladaptor.h"
+#include "appcontroller.h"
+#include <QDBusError>
+
+CameraControlAdaptor::CameraControlAdaptor(AppController *parent)
+    : QDBusAbstractAdaptor(parent), m_controller(parent)
+{
+    connect(parent, &AppController::captureSaved, this, &CameraControlAdaptor::CaptureSaved);
+    connect(parent, &AppController::captureFailed, this, &CameraControlAdaptor::CaptureFailed);
+    connect(parent, &AppController::recordingFinalized, this, &CameraControlAdaptor::RecordingFinalized);
+}
+
+int CameraControlAdaptor::CapturePhoto(const QString &path)
+{
+    QString error;
+    const int id = m_controller->capturePhoto(path, &error);
+    if (id < 0) {
+        sendErrorReply(QDBusError::Failed, error);
+    }
+    return id;
+}
+
+QString CameraControlAdaptor::StartRecording()
+{
+    const QString path = m_controller->startRecording();
+    if (path.isEmpty()) {
+        sendErrorReply(QDBusError::Failed, "A recording or a capture is already running");
+    }
+    return path;
+}
+
+void CameraControlAdaptor::StopRecording()
+{
+    if (!m_controller->stopRecording()) {
+        sendErrorReply(QDBusError::Failed, "Nothing is being recorded");
+    }
+}
+
+void CameraControlAdaptor::SetCamera(const QString &deviceId)
+{
+    if (!m_controller->setCamera(deviceId)) {
+        sendErrorReply(QDBusError::InvalidArgs, "No camera " + deviceId + ", or it can't be changed while recording");
+    }
+}
+
+QVariantMap CameraControlAdaptor::GetStatus()
+{
+    return m_controller->status();
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef CAMERACONTROLADAPTOR_H
+#define CAMERACONTROLADAPTOR_H
+
+#include <QDBusAbstractAdaptor>
+#include <QDBusContext>
+#include <QVariantMap>
+
+class AppController;
+
+// io.furios.Camera on /io/furios/Camera/Control, below org.freedesktop.Application.
+// Drives captures for scripts and test fixtures, with or without the window.
+class CameraControlAdaptor : public QDBusAbstractAdaptor, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "io.furios.Camera")
+public:
+    explicit CameraControlAdaptor(AppController *parent);
+
+public slots:
+    // Returns the id CaptureSaved or CaptureFailed report, an empty path uses the gallery
+    int CapturePhoto(const QString &path);
+    // Returns the file being recorded
+    QString StartRecording();
+    void StopRecording();
+    void SetCamera(const QString &deviceId);
+    QVariantMap GetStatus();
+
+signals:
+    // timings holds activateMs, captureMs, saveMs and totalMs from the request
+    void CaptureSaved(int id, const QString &path, const QVariantMap &timings);
+    // Also sent with "Timed out" for a capture that is not saved within 10 s
+    void CaptureFailed(int id, const QString &message);
+    // timings holds startMs, durationMs and finalizeMs, startMs only for recordings started here
+    void RecordingFinalized(const QString &path, const QVariantMap &timings);
+
+private:
+    AppController *m_controller;
+};
+
+#endif // CAMERACONTROLADAPTOR_H
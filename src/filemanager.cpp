@@ -11,21 +11,41 @@
 #include "filemanager.h"
 #include "geocluefind.h"
 #include "exif.h"
+#include "settingsmanager.h"
 #include <QDir>
 #include <QStandardPaths>
 #include <QFile>
 #include <QProcess>
 #include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTimer>
 #include <QDebug>
 #include <iomanip>
 #include <exiv2/exiv2.hpp>
 #include <cmath>
 
+#define LAST_FIX_SAVE_INTERVAL 30000
+// How long the GeoClue client keeps running after the window is hidden
+#define GPS_GRACE_PERIOD 60000
+
 
 FileManager::FileManager(QObject *parent) : QObject(parent), m_geoClueInstance(nullptr), m_locationAvailable(new int(0)) {
+    m_lastFixPath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/furios-camera/last-location.json";
+    loadLastFix();
+
+    m_gpsGraceTimer = new QTimer(this);
+    m_gpsGraceTimer->setSingleShot(true);
+    m_gpsGraceTimer->setInterval(GPS_GRACE_PERIOD);
+    connect(m_gpsGraceTimer, &QTimer::timeout, this, &FileManager::onGpsGracePeriodOver);
 }
 
 FileManager::~FileManager() {
+    if (m_lastFixDirty) {
+        saveLastFix();
+    }
+
     delete m_geoClueInstance;
     delete m_locationAvailable;
 }
@@ -104,23 +124,6 @@ QStringList FileManager::decimalToDMS(double decimal, bool isLongitude) { // Thi
 
 void FileManager::appendGPSMetadata(const QString &fileUrl) {
 
-    QStringList coordinates = getCurrentLocation();
-
-    if (coordinates.size() != 4) {
-        qDebug() << "Error: Invalid number of coordinates";
-        return;
-    }
-
-    QString latitude = coordinates[0];
-    QString longitude = coordinates[1];
-    QString altitude = coordinates[2];
-    QString heading = coordinates[3];
-
-    double lat = latitude.toDouble();
-    double lon = longitude.toDouble();
-    double alt = altitude.toDouble();
-    double hdg = heading.toDouble();
-
     std::unique_ptr<Exiv2::Image> image = Exiv2::ImageFactory::open(fileUrl.toStdString());
     if (!image) {
         qDebug() << "Error: Could not open image file: " << fileUrl;
@@ -128,7 +131,46 @@ void FileManager::appendGPSMetadata(const QString &fileUrl) {
     }
     image->readMetadata();
 
-    Exiv2::ExifData& exifData = image->exifData();
+    // The file is written a moment after the shutter, and the position may have
+    // moved on since, so the fix closest to the capture time is used
+    QDateTime captureTime;
+    Exiv2::ExifData::const_iterator dateTimeOriginal = image->exifData().findKey(Exiv2::ExifKey("Exif.Photo.DateTimeOriginal"));
+    if (dateTimeOriginal != image->exifData().end()) {
+        captureTime = QDateTime::fromString(QString::fromStdString(dateTimeOriginal->toString()), "yyyy:MM:dd HH:mm:ss");
+    }
+    if (!captureTime.isValid()) {
+        captureTime = QFileInfo(fileUrl).lastModified();
+    }
+
+    // A fix further from the capture than a later one could replace is not
+    // live, the photo is tagged provisionally and upgraded instead
+    const qint64 liveWindowMs = SettingsManager::instance().gpsUpgradeWindow() * 1000LL;
+    GeoClueProperties fix;
+    bool liveFix = *m_locationAvailable == 1 && m_geoClueInstance != nullptr && m_geoClueInstance->getPropertiesAt(captureTime, liveWindowMs, fix);
+
+    if (!liveFix) {
+        // Right after start or resume there is no recent fix yet, the last known
+        // position tags the photo until a live fix replaces it
+        if (!m_lastFix.Timestamp.isValid() || m_lastFix.Timestamp.secsTo(captureTime) > SettingsManager::instance().gpsMaxFixAge()) {
+            qDebug() << "GPS data not available yet";
+            return;
+        }
+
+        fix = m_lastFix;
+        m_provisionalTags.append(qMakePair(fileUrl, captureTime));
+        qDebug() << "Tagging" << fileUrl << "with the last known location from" << fix.Timestamp;
+    }
+
+    writeGpsTags(*image, fix);
+}
+
+void FileManager::writeGpsTags(Exiv2::Image &image, const GeoClueProperties &fix) {
+    Exiv2::ExifData& exifData = image.exifData();
+
+    double lat = fix.Latitude;
+    double lon = fix.Longitude;
+    double alt = fix.Altitude;
+    double hdg = fix.Heading;
 
     QStringList latDMS = decimalToDMS(lat);
     exifData["Exif.GPSInfo.GPSLatitude"] = latDMS.join(" ").toStdString();
@@ -138,9 +180,18 @@ void FileManager::appendGPSMetadata(const QString &fileUrl) {
     exifData["Exif.GPSInfo.GPSLongitude"] = lonDMS.join(" ").toStdString();
     exifData["Exif.GPSInfo.GPSLongitudeRef"] = (lon >= 0) ? "E" : "W";
 
-    if (alt != -1.79769e+308) {
+    // GeoClue reports an unknown altitude as -DBL_MAX, which is -inf as a float
+    if (std::isfinite(alt) && alt != -1.79769e+308) {
         exifData["Exif.GPSInfo.GPSAltitude"] = QString("%1/1").arg(std::abs(alt)).toStdString();
         exifData["Exif.GPSInfo.GPSAltitudeRef"] = (alt >= 0) ? "0" : "1";  // 0 = Above sea level, 1 = Below sea level
+    } else {
+        // A provisional tag may have set one that the live fix does not have
+        for (const char *key : {"Exif.GPSInfo.GPSAltitude", "Exif.GPSInfo.GPSAltitudeRef"}) {
+            Exiv2::ExifData::iterator it = exifData.findKey(Exiv2::ExifKey(key));
+            if (it != exifData.end()) {
+                exifData.erase(it);
+            }
+        }
     }
 
     if (hdg != -1) {
@@ -148,7 +199,70 @@ void FileManager::appendGPSMetadata(const QString &fileUrl) {
         exifData["Exif.GPSInfo.GPSImgDirectionRef"] = "T";
     }
 
-    image->writeMetadata();
+    image.writeMetadata();
+}
+
+void FileManager::upgradeProvisionalTags(const GeoClueProperties &fix) {
+    const int window = SettingsManager::instance().gpsUpgradeWindow();
+    const QDateTime now = QDateTime::currentDateTime();
+
+    for (auto it = m_provisionalTags.begin(); it != m_provisionalTags.end(); ) {
+        const QString &fileUrl = it->first;
+        const QDateTime &captureTime = it->second;
+
+        if (std::abs(fix.Timestamp.secsTo(captureTime)) <= window) {
+            std::unique_ptr<Exiv2::Image> image = Exiv2::ImageFactory::open(fileUrl.toStdString());
+            if (image) {
+                image->readMetadata();
+                writeGpsTags(*image, fix);
+                qDebug() << "Replaced the last known location in" << fileUrl;
+            }
+            it = m_provisionalTags.erase(it);
+        } else if (captureTime.secsTo(now) > window) {
+            it = m_provisionalTags.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FileManager::loadLastFix() {
+    QFile file(m_lastFixPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject fix = QJsonDocument::fromJson(file.readAll()).object();
+
+    m_lastFix.Latitude = fix.value("latitude").toDouble();
+    m_lastFix.Longitude = fix.value("longitude").toDouble();
+    m_lastFix.Altitude = fix.value("altitude").toDouble(-1.79769e+308);
+    m_lastFix.Heading = -1;
+    m_lastFix.Accuracy = fix.value("accuracy").toDouble();
+    m_lastFix.Speed = 0;
+    m_lastFix.Timestamp = QDateTime::fromMSecsSinceEpoch(fix.value("timestamp").toVariant().toLongLong());
+}
+
+void FileManager::saveLastFix() {
+    QJsonObject fix{
+        {"latitude", m_lastFix.Latitude},
+        {"longitude", m_lastFix.Longitude},
+        {"accuracy", m_lastFix.Accuracy},
+        {"timestamp", m_lastFix.Timestamp.toMSecsSinceEpoch()},
+    };
+    if (std::isfinite(m_lastFix.Altitude)) {
+        fix.insert("altitude", m_lastFix.Altitude);
+    }
+
+    QDir().mkpath(QFileInfo(m_lastFixPath).absolutePath());
+
+    QSaveFile file(m_lastFixPath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(fix).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+    m_lastFixSaved.start();
+    m_lastFixDirty = false;
 }
 
 QString FileManager::getFileSize(const QString &fileUrl) {
@@ -596,9 +710,13 @@ QStringList FileManager::getCurrentLocation() {
 }
 
 void FileManager::restartGps() {
-    m_geoClueInstance = new GeoClueFind(this);
-    connect(m_geoClueInstance, &GeoClueFind::locationUpdated, this, &FileManager::onLocationUpdated);
-    connect(m_geoClueInstance, &GeoClueFind::clientDeleted, this, &FileManager::onClientDeleted);
+    // A client kept from before the window was hidden is started again rather
+    // than replaced
+    if (m_geoClueInstance) {
+        resumeGps();
+    } else {
+        turnOnGps();
+    }
 }
 
 void FileManager::turnOnGps() {
@@ -607,25 +725,103 @@ void FileManager::turnOnGps() {
         m_geoClueInstance = new GeoClueFind(this);
         connect(m_geoClueInstance, &GeoClueFind::locationUpdated, this, &FileManager::onLocationUpdated);
         connect(m_geoClueInstance, &GeoClueFind::clientDeleted, this, &FileManager::onClientDeleted);
+        connect(m_geoClueInstance, &GeoClueFind::failed, this, &FileManager::onGpsFailed);
+    } else {
+        resumeGps();
     }
 }
 
 void FileManager::turnOffGps() {
     GeoClueFind* geoClue = m_geoClueInstance;
 
+    m_gpsGraceTimer->stop();
+
+    if (m_lastFixDirty) {
+        saveLastFix();
+    }
+
     if (geoClue) {
+        // Forgotten right away so turning GPS back on before GeoClue answers
+        // gets a new client, the old one is deleted in onClientDeleted
+        m_geoClueInstance = nullptr;
+        *m_locationAvailable = 0;
         geoClue->stopClient();
     } else {
         qDebug() << "GeoClue instance is null!";
     }
 }
 
+void FileManager::pauseGps() {
+    if (m_geoClueInstance == nullptr) {
+        return;
+    }
+
+    if (m_lastFixDirty) {
+        saveLastFix();
+    }
+
+    // The client keeps running for a while, so quickly coming back to the
+    // camera has a fix straight away
+    m_gpsGraceTimer->start();
+}
+
+void FileManager::resumeGps() {
+    m_gpsGraceTimer->stop();
+
+    if (m_geoClueInstance) {
+        m_geoClueInstance->resumeClient();
+    }
+}
+
+void FileManager::onGpsGracePeriodOver() {
+    if (m_geoClueInstance) {
+        // No fixes arrive while paused, the next one after resuming makes the
+        // location available again
+        *m_locationAvailable = 0;
+        m_geoClueInstance->pauseClient();
+    }
+}
+
 void FileManager::onLocationUpdated() {
+    GeoClueFind *geoClue = qobject_cast<GeoClueFind *>(sender());
+
+    // Late update from a client that is being deleted
+    if (geoClue != m_geoClueInstance) {
+        return;
+    }
+
     *m_locationAvailable = 1;
+
+    m_lastFix = geoClue->getProperties();
+    m_lastFixDirty = true;
+    upgradeProvisionalTags(m_lastFix);
+
+    // Fixes can arrive several times a second, the file only needs to be recent
+    if (!m_lastFixSaved.isValid() || m_lastFixSaved.elapsed() > LAST_FIX_SAVE_INTERVAL) {
+        saveLastFix();
+    }
+
     emit gpsDataReady();
 }
 
 void FileManager::onClientDeleted() {
-    delete m_geoClueInstance;
-    m_geoClueInstance = nullptr;
+    // Emitted from one of the client's own reply handlers
+    GeoClueFind *geoClue = qobject_cast<GeoClueFind *>(sender());
+    geoClue->deleteLater();
+
+    if (geoClue == m_geoClueInstance) {
+        m_geoClueInstance = nullptr;
+    }
+}
+
+void FileManager::onGpsFailed(const QString &reason) {
+    qWarning() << "GPS unavailable:" << reason;
+
+    // Dropped so the next turnOnGps starts over with a new client
+    GeoClueFind *geoClue = qobject_cast<GeoClueFind *>(sender());
+    geoClue->deleteLater();
+
+    if (geoClue == m_geoClueInstance) {
+        m_geoClueInstance = nullptr;
+    }
 }
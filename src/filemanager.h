@@ -16,6 +16,13 @@
 #include <QStringList>
 #include "exif.h"
 #include "geocluefind.h"
+#include <QElapsedTimer>
+
+class QTimer;
+
+namespace Exiv2 {
+class Image;
+}
 
 class FileManager : public QObject
 {
@@ -59,6 +66,9 @@ public:
     Q_INVOKABLE void turnOnGps();
     Q_INVOKABLE QString getTimeFormat();
     void restartGps();
+    // Window hidden and shown again, the client is kept across the two
+    void pauseGps();
+    void resumeGps();
     Q_INVOKABLE void appendGPSMetadata(const QString &fileUrl);
     QStringList decimalToDMS(double decimal, bool isLongitude = false);
 
@@ -68,10 +78,25 @@ signals:
 private slots:
     void onLocationUpdated();
     void onClientDeleted();
+    void onGpsFailed(const QString &reason);
+    void onGpsGracePeriodOver();
 
 private:
+    void writeGpsTags(Exiv2::Image &image, const GeoClueProperties &fix);
+    void upgradeProvisionalTags(const GeoClueProperties &fix);
+    void loadLastFix();
+    void saveLastFix();
+
     GeoClueFind* m_geoClueInstance;
     int *m_locationAvailable;
+    // Last fix we got, kept across restarts
+    GeoClueProperties m_lastFix = GeoClueProperties();
+    QString m_lastFixPath;
+    QElapsedTimer m_lastFixSaved;
+    bool m_lastFixDirty = false;
+    QTimer *m_gpsGraceTimer;
+    // Photos tagged with the last known location, with their capture time
+    QList<QPair<QString, QDateTime>> m_provisionalTags;
 };
 
 #endif // FILEMANAGER_H
@@ -9,48 +9,145 @@
 
 #include "flashlightcontroller.h"
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 
-FlashlightController::FlashlightController(QObject *parent) : QObject(parent)
+// Patterns stop once the LED, camera or battery sensor reads this, in millidegrees
+#define TORCH_THERMAL_LIMIT 60000
+
+FlashlightController::FlashlightController(QObject *parent, const QString &sysfsRoot) : QObject(parent)
 {
-    QStringList filePaths = {"/sys/class/leds/torch-light/brightness",
-                            "/sys/class/leds/led:flash_torch/brightness",
-                            "/sys/class/leds/flashlight/brightness",
-                            "/sys/class/leds/torch-light0/brightness",
-                            "/sys/class/leds/torch-light1/brightness",
-                            "/sys/class/leds/led:torch_0/brightness",
-                            "/sys/class/leds/led:torch_1/brightness",
-                            "/sys/devices/platform/soc/soc:i2c@1/i2c-23/23-0059/s2mpb02-led/leds/torch-sec1/brightness",
-                            "/sys/class/leds/led:switch/brightness",
-                            "/sys/class/leds/led:switch_0/brightness",
-                            "/sys/devices/virtual/camera/flash/rear_flash"};
+    discoverLeds(sysfsRoot);
+    discoverThermalSensor(sysfsRoot);
 
-    for (const auto &path : filePaths) {
-        QFile *file = new QFile(path);
-        m_flashlightFiles.append(file);
-    }
+    m_patternEngine.setLeds(m_leds);
+    connect(&m_patternEngine, &TorchPatternEngine::patternFinished, this, &FlashlightController::onPatternFinished);
 }
 
 FlashlightController::~FlashlightController()
 {
-    qDeleteAll(m_flashlightFiles);
-    m_flashlightFiles.clear();
+    m_patternEngine.stop();
+
+    for (const TorchLed &led : m_leds) {
+        ::close(led.fd);
+    }
+    m_leds.clear();
 }
 
-void FlashlightController::turnFlashlightOn()
+void FlashlightController::discoverLeds(const QString &sysfsRoot)
 {
-    for (auto *file : m_flashlightFiles) {
-        writeFile(file, QStringLiteral("1"));
+    // Torch LEDs go by many names, flash-only LEDs are left alone since they
+    // are meant to fire at flash current
+    const QDir leds(sysfsRoot + "/class/leds");
+    for (const QString &name : leds.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const bool isSwitch = name.contains("switch");
+        const bool isTorch = name.contains("torch") || name == "flashlight";
+
+        if (!isSwitch && !isTorch) {
+            continue;
+        }
+
+        const QString directory = leds.filePath(name);
+        addLed(directory + "/brightness", isSwitch ? 1 : readMaxBrightness(directory), isSwitch);
+    }
+
+    // Vendor drivers that do not register with the LED class
+    const QStringList legacyPaths = {"/devices/platform/soc/soc:i2c@1/i2c-23/23-0059/s2mpb02-led/leds/torch-sec1/brightness",
+                                     "/devices/virtual/camera/flash/rear_flash"};
+
+    for (const QString &path : legacyPaths) {
+        if (QFile::exists(sysfsRoot + path)) {
+            addLed(sysfsRoot + path, 1, false);
+        }
     }
 
+    // Qualcomm drivers latch the torch current when the switch is written, so
+    // switches go after every torch and legacy LED, and the LEDs are always
+    // written in this order
+    std::stable_partition(m_leds.begin(), m_leds.end(), [](const TorchLed &led) { return !led.isSwitch; });
+
+    for (const TorchLed &led : m_leds) {
+        if (!led.isSwitch) {
+            m_minBrightness = 1.0 / led.maxBrightness;
+            break;
+        }
+    }
+    m_brightness = m_minBrightness;
+
+    if (m_leds.isEmpty()) {
+        qDebug() << "No flashlight LEDs found under" << sysfsRoot;
+    }
+}
+
+void FlashlightController::discoverThermalSensor(const QString &sysfsRoot)
+{
+    // The sensor closest to the LED wins, the battery is the usual fallback
+    const QStringList preferred = {"flash", "led", "camera", "battery"};
+    const QDir thermal(sysfsRoot + "/class/thermal");
+    QString sensor;
+    int sensorRank = preferred.size();
+
+    for (const QString &zone : thermal.entryList({"thermal_zone*"}, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QFile type(thermal.filePath(zone) + "/type");
+        if (!type.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        const QString name = QString::fromUtf8(type.readAll()).trimmed().toLower();
+        for (int rank = 0; rank < sensorRank; rank++) {
+            if (name.contains(preferred[rank])) {
+                sensor = thermal.filePath(zone) + "/temp";
+                sensorRank = rank;
+                break;
+            }
+        }
+    }
+
+    if (sensor.isEmpty()) {
+        qDebug() << "No thermal sensor for the torch, patterns only stop on their timeout";
+        return;
+    }
+
+    m_patternEngine.setThermalSensor(sensor, TORCH_THERMAL_LIMIT);
+}
+
+void FlashlightController::addLed(const QString &brightnessPath, int maxBrightness, bool isSwitch)
+{
+    const int fd = ::open(QFile::encodeName(brightnessPath).constData(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    qDebug() << "Flashlight LED" << brightnessPath << "max brightness" << maxBrightness;
+    m_leds.append({brightnessPath, fd, qMax(1, maxBrightness), isSwitch});
+}
+
+int FlashlightController::readMaxBrightness(const QString &ledDirectory)
+{
+    QFile file(ledDirectory + "/max_brightness");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 1;
+    }
+
+    return file.readAll().trimmed().toInt();
+}
+
+void FlashlightController::turnFlashlightOn()
+{
+    m_patternEngine.stop();
+    writeLeds(true);
+
     m_flashlightOn = true;
     emit flashlightOnChanged(m_flashlightOn);
 }
 
 void FlashlightController::turnFlashlightOff()
 {
-    for (auto *file : m_flashlightFiles) {
-        writeFile(file, QStringLiteral("0"));
-    }
+    m_patternEngine.stop();
+    writeLeds(false);
 
     m_flashlightOn = false;
     emit flashlightOnChanged(m_flashlightOn);
@@ -61,13 +158,124 @@ bool FlashlightController::isFlashlightOn() const
     return m_flashlightOn;
 }
 
-void FlashlightController::writeFile(QFile *file, const QString &value)
+bool FlashlightController::isPatternRunning() const
 {
-    if (!file->open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return m_patternRunning;
+}
+
+void FlashlightController::pulse(int durationMs)
+{
+    // Without a length it would stay on until the timeout
+    if (durationMs <= 0) {
+        qDebug() << "Ignoring a torch pulse of" << durationMs << "ms";
         return;
     }
 
-    QTextStream out(file);
-    out << value;
-    file->close();
+    TorchPattern pattern;
+    pattern.type = TorchPattern::Pulse;
+    pattern.durationMs = durationMs;
+    pattern.timeoutMs = qMax(durationMs, pattern.timeoutMs);
+    playPattern(pattern);
+}
+
+void FlashlightController::strobe(qreal frequency, int durationMs, int timeoutMs)
+{
+    TorchPattern pattern;
+    pattern.type = TorchPattern::Strobe;
+    pattern.frequency = frequency;
+    pattern.durationMs = durationMs;
+    pattern.timeoutMs = timeoutMs;
+    playPattern(pattern);
+}
+
+void FlashlightController::ramp(qreal from, qreal to, int durationMs, int timeoutMs)
+{
+    TorchPattern pattern;
+    pattern.type = TorchPattern::Ramp;
+    // The whole range of the LEDs, whatever the brightness is set to
+    pattern.from = qBound(0.0, from, 1.0);
+    pattern.to = qBound(0.0, to, 1.0);
+    pattern.durationMs = durationMs;
+    pattern.timeoutMs = timeoutMs;
+    playPattern(pattern);
+}
+
+void FlashlightController::playPattern(TorchPattern pattern)
+{
+    pattern.brightness = m_brightness;
+    m_patternId = m_patternEngine.play(pattern);
+
+    if (!m_patternRunning) {
+        m_patternRunning = true;
+        emit patternRunningChanged(m_patternRunning);
+    }
+}
+
+void FlashlightController::stopPattern()
+{
+    m_patternEngine.stop();
+}
+
+void FlashlightController::onPatternFinished(int id, const QString &reason)
+{
+    // A pattern that was replaced by another one reports too
+    if (id != m_patternId || !m_patternRunning) {
+        return;
+    }
+
+    writeLeds(m_flashlightOn);
+
+    m_patternRunning = false;
+    emit patternRunningChanged(m_patternRunning);
+    emit patternFinished(reason);
+}
+
+TorchPatternEngine::Stats FlashlightController::patternStats() const
+{
+    return m_patternEngine.stats();
+}
+
+qreal FlashlightController::brightness() const
+{
+    return m_brightness;
+}
+
+void FlashlightController::setBrightness(qreal brightness)
+{
+    brightness = qBound(m_minBrightness, brightness, 1.0);
+    if (brightness == m_brightness) {
+        return;
+    }
+
+    m_brightness = brightness;
+
+    if (m_flashlightOn && !m_patternRunning) {
+        writeLeds(true);
+    }
+
+    emit brightnessChanged(m_brightness);
+}
+
+QStringList FlashlightController::ledPaths() const
+{
+    QStringList paths;
+    for (const TorchLed &led : m_leds) {
+        paths.append(led.path);
+    }
+    return paths;
+}
+
+void FlashlightController::writeLeds(bool on)
+{
+    // In discovery order, which puts the switches last
+    for (const TorchLed &led : m_leds) {
+        // The dimmest level still lights the LED, 0 is only written for off
+        const int value = !on ? 0 : led.isSwitch ? 1 : qMax(1, qRound(m_brightness * led.maxBrightness));
+        const QByteArray text = QByteArray::number(value);
+
+        // sysfs attributes are rewritten from the start on every write
+        if (::pwrite(led.fd, text.constData(), text.size(), 0) < 0) {
+            qDebug() << "Failed to write" << led.path;
+        }
+    }
 }
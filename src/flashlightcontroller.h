@@ -11,30 +11,73 @@
 #define FLASHLIGHTCONTROLLER_H
 
 #include <QObject>
-#include <QFile>
+#include <QStringList>
+#include <QVector>
+#include "torchpatternengine.h"
 
 class FlashlightController : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(bool flashlightOn READ isFlashlightOn NOTIFY flashlightOnChanged)
+    Q_PROPERTY(qreal brightness READ brightness WRITE setBrightness NOTIFY brightnessChanged)
+    Q_PROPERTY(bool patternRunning READ isPatternRunning NOTIFY patternRunningChanged)
 
 public:
-    explicit FlashlightController(QObject *parent = nullptr);
+    // The LEDs are looked up once under sysfsRoot, which is only changed to
+    // point the controller at a fake tree
+    explicit FlashlightController(QObject *parent = nullptr, const QString &sysfsRoot = QStringLiteral("/sys"));
     ~FlashlightController();
 
     Q_INVOKABLE void turnFlashlightOn();
     Q_INVOKABLE void turnFlashlightOff();
 
+    // Timed patterns, played off the GUI thread at the current brightness, except
+    // ramps, whose from and to are 0 to 1 of max_brightness. They stop on their
+    // own after timeoutMs or when the LEDs get too hot, and the torch goes back
+    // to its on/off state afterwards.
+    Q_INVOKABLE void pulse(int durationMs);
+    Q_INVOKABLE void strobe(qreal frequency, int durationMs = 0, int timeoutMs = 10000);
+    Q_INVOKABLE void ramp(qreal from, qreal to, int durationMs, int timeoutMs = 10000);
+    Q_INVOKABLE void stopPattern();
+
     bool isFlashlightOn() const;
+    bool isPatternRunning() const;
+
+    // Up to 1 of each LED's max_brightness, LEDs that are only on or off ignore it.
+    // It can't go below the dimmest level of the first torch LED, which is the
+    // default since the torch has always been turned on by writing 1.
+    qreal brightness() const;
+    void setBrightness(qreal brightness);
+
+    // Brightness files that were found and opened
+    QStringList ledPaths() const;
+    TorchPatternEngine::Stats patternStats() const;
 
 signals:
     void flashlightOnChanged(bool flashlightOn);
+    void brightnessChanged(qreal brightness);
+    void patternRunningChanged(bool patternRunning);
+    // "done", "stopped", "timeout" or "thermal"
+    void patternFinished(const QString &reason);
+
+private slots:
+    void onPatternFinished(int id, const QString &reason);
 
 private:
-    QList<QFile*> m_flashlightFiles;
+    QVector<TorchLed> m_leds;
     bool m_flashlightOn = false;
+    qreal m_brightness = 1.0;
+    qreal m_minBrightness = 1.0;
+    TorchPatternEngine m_patternEngine;
+    bool m_patternRunning = false;
+    int m_patternId = 0;
 
-    void writeFile(QFile *file, const QString &value);
+    void discoverLeds(const QString &sysfsRoot);
+    void discoverThermalSensor(const QString &sysfsRoot);
+    void playPattern(TorchPattern pattern);
+    void addLed(const QString &brightnessPath, int maxBrightness, bool isSwitch);
+    void writeLeds(bool on);
+    static int readMaxBrightness(const QString &ledDirectory);
 };
 
 #endif // FLASHLIGHT
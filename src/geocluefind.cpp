@@ -8,15 +8,20 @@
 #include "geocluefind.h"
 #include <QDBusInterface>
 #include <QDBusReply>
+#include <QDBusPendingCallWatcher>
 #include <QDebug>
 #include <QVariantMap>
 #include <QStringList>
+#include <QDBusArgument>
 #include <iomanip>
+#include <cstdlib>
 
 #define BUS_NAME QString("org.freedesktop.GeoClue2")
 #define MANAGER_PATH QString("/org/freedesktop/GeoClue2/Manager")
+// Enough to cover the time between pressing the shutter and the file being saved
+#define FIX_HISTORY_SIZE 32
 
-GeoClueFind::GeoClueFind(QObject *parent) : QObject(parent), m_clientObjPath(new QString("")), m_properties(new GeoClueProperties()), m_locationObjPath(new QString("")) {
+GeoClueFind::GeoClueFind(QObject *parent) : QObject(parent), m_nextFix(0), m_fetching(false), m_fetchPending(false), m_clientObjPath(new QString("")), m_locationObjPath(new QString("")), m_stopRequested(false), m_configured(false), m_paused(false) {
     qDebug() << "Init GPS Client";
     getGeoclueClient();
 }
@@ -24,101 +29,222 @@ GeoClueFind::GeoClueFind(QObject *parent) : QObject(parent), m_clientObjPath(new
 GeoClueFind::~GeoClueFind() {
     delete m_clientObjPath;
     delete m_locationObjPath;
-    delete m_properties;
 }
 
-void GeoClueFind::getGeoclueClient() {
+void GeoClueFind::call(const QDBusMessage &message, std::function<void(const QDBusMessage &)> onReply) {
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
 
-    QDBusConnection dbusConnection = QDBusConnection::systemBus();
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [onReply](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        onReply(watcher->reply());
+    });
+}
 
-    QDBusInterface dbusInterface(BUS_NAME, MANAGER_PATH, "org.freedesktop.GeoClue2.Manager", dbusConnection);
+void GeoClueFind::getGeoclueClient() {
+    QDBusMessage getClient = QDBusMessage::createMethodCall(BUS_NAME, MANAGER_PATH, "org.freedesktop.GeoClue2.Manager", "GetClient");
 
-    if (!dbusInterface.isValid()) {
-        qWarning() << "D-Bus org.freedesktop.GeoClue2.Manager interface is not valid!";
-    }
+    call(getClient, [this](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "DBus GetClient call failed: " << reply.errorMessage();
+            emit failed(reply.errorMessage());
+            return;
+        }
 
-    QDBusReply<QDBusObjectPath> reply = dbusInterface.call("GetClient");
-    if (!reply.isValid()) {
-        qWarning() << "DBus GetClient call failed: " << reply.error().message();
-    }
+        *m_clientObjPath = qdbus_cast<QDBusObjectPath>(reply.arguments().value(0)).path();
 
-    *m_clientObjPath = reply.value().path();
+        qDebug() << "GeoClue Client: " << *m_clientObjPath;
 
-    qDebug() << "GeoClue Client: " << *m_clientObjPath;
+        // Turned off again while we were waiting for the client
+        if (m_stopRequested) {
+            stopClient();
+            return;
+        }
 
-    setClientInterface();
+        setClientInterface();
+    });
 }
 
 void GeoClueFind::setClientInterface() {
-
     QDBusConnection dbusConnection = QDBusConnection::systemBus();
 
-    QDBusInterface clientInterface(BUS_NAME, *m_clientObjPath, "org.freedesktop.GeoClue2.Client", dbusConnection);
-    if (!clientInterface.isValid()) {
-        qWarning() << "D-Bus org.freedesktop.GeoClue2.Client interface is not valid!";
+    if (!dbusConnection.connect(BUS_NAME, *m_clientObjPath, QString("org.freedesktop.GeoClue2.Client"), QString("LocationUpdated"), QString("oo"), this,
+                                SLOT(locationAvailable(QDBusObjectPath, QDBusObjectPath)))) {
+        qWarning() << "Unable to attach Location Updated Callback.";
     }
 
-    if (!clientInterface.setProperty("DesktopId", "furios-camera")) {
-        qWarning() << "DBus call to set DesktopId failed";
+    const QList<QPair<QString, QVariant>> properties = {
+        {"DesktopId", QString("furios-camera")},
+        {"DistanceThreshold", QVariant::fromValue(0u)},
+        {"TimeThreshold", QVariant::fromValue(0u)},
+        // EXACT
+        {"RequestedAccuracyLevel", QVariant::fromValue<uint>(8)},
+    };
+
+    // GeoClue handles the calls of one connection in order, so the property sets
+    // and Start are all sent at once instead of waiting for each reply
+    for (const QPair<QString, QVariant> &property : properties) {
+        QDBusMessage set = QDBusMessage::createMethodCall(BUS_NAME, *m_clientObjPath, "org.freedesktop.DBus.Properties", "Set");
+        set << QString("org.freedesktop.GeoClue2.Client") << property.first << QVariant::fromValue(QDBusVariant(property.second));
+
+        const QString name = property.first;
+        call(set, [name](const QDBusMessage &reply) {
+            if (reply.type() == QDBusMessage::ErrorMessage) {
+                qWarning() << "Failed to set" << name << ":" << reply.errorMessage();
+            }
+        });
     }
 
-    if (!clientInterface.setProperty("DistanceThreshold", QVariant::fromValue(0u))) {
-        qWarning() << "Failed to set DistanceThreshold";
-    }
+    m_configured = true;
 
-    if (!clientInterface.setProperty("TimeThreshold", QVariant::fromValue(0u))) {
-        qWarning() << "Failed to set TimeThreshold";
+    // Paused before the handshake finished, resumeClient will start it
+    if (!m_paused) {
+        startClient();
     }
+}
 
-    if (!clientInterface.setProperty("RequestedAccuracyLevel", QVariant::fromValue<uint>(8))) {
-        qWarning() << "Failed to set RequestedAccuracyLevel to EXACT";
-    }
+void GeoClueFind::startClient() {
+    QDBusMessage start = QDBusMessage::createMethodCall(BUS_NAME, *m_clientObjPath, "org.freedesktop.GeoClue2.Client", "Start");
+
+    call(start, [this](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "DBus call to start GeoClue client failed: " << reply.errorMessage();
+            emit failed(reply.errorMessage());
+        } else {
+            emit ready();
+        }
+    });
+}
 
-    if (!dbusConnection.connect(BUS_NAME, *m_clientObjPath, QString("org.freedesktop.GeoClue2.Client"), QString("LocationUpdated"), QString("oo"), this,
-                                SLOT(locationAvailable(QDBusObjectPath, QDBusObjectPath)))) {
-        qWarning() << "Unable to attach Location Updated Callback.";
+void GeoClueFind::locationAvailable(QDBusObjectPath oldLocation, QDBusObjectPath newLocation) {
+    Q_UNUSED(oldLocation);
+
+    *m_locationObjPath = newLocation.path();
+
+    // Updates that arrive while a fetch is in flight collapse into one fetch of
+    // the newest location once it returns
+    if (m_fetching) {
+        m_fetchPending = true;
+        return;
     }
 
-    QDBusMessage message = clientInterface.call("Start");
+    fetchLocation();
+}
+
+void GeoClueFind::fetchLocation() {
+    m_fetching = true;
+    m_fetchPending = false;
+
+    QDBusMessage getAll = QDBusMessage::createMethodCall(BUS_NAME, *m_locationObjPath, "org.freedesktop.DBus.Properties", "GetAll");
+    getAll << QString("org.freedesktop.GeoClue2.Location");
+
+    call(getAll, [this](const QDBusMessage &reply) {
+        m_fetching = false;
+
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "Failed to get properties:" << reply.errorMessage();
+        } else {
+            const QVariantMap propertiesMap = qdbus_cast<QVariantMap>(reply.arguments().value(0));
+            GeoClueProperties fix;
+
+            fix.Latitude = propertiesMap.value("Latitude").toFloat();
+            fix.Longitude = propertiesMap.value("Longitude").toFloat();
+            fix.Accuracy = propertiesMap.value("Accuracy").toFloat();
+            fix.Altitude = propertiesMap.value("Altitude").toFloat();
+            fix.Speed = propertiesMap.value("Speed").toFloat();
+            fix.Heading = propertiesMap.value("Heading").toFloat();
+            fix.Description = propertiesMap.value("Description").toString();
+
+            // (tt) seconds and microseconds since the epoch
+            const QVariant timestamp = propertiesMap.value("Timestamp");
+            if (timestamp.userType() == qMetaTypeId<QDBusArgument>()) {
+                quint64 seconds = 0;
+                quint64 microseconds = 0;
+                const QDBusArgument argument = timestamp.value<QDBusArgument>();
+                argument.beginStructure();
+                argument >> seconds >> microseconds;
+                argument.endStructure();
+                fix.Timestamp = QDateTime::fromMSecsSinceEpoch(seconds * 1000 + microseconds / 1000);
+            } else {
+                fix.Timestamp = QDateTime::currentDateTime();
+            }
+
+            if (m_fixes.size() < FIX_HISTORY_SIZE) {
+                m_fixes.append(fix);
+            } else {
+                m_fixes[m_nextFix] = fix;
+            }
+            m_nextFix = (m_nextFix + 1) % FIX_HISTORY_SIZE;
+
+            emit locationUpdated();
+        }
+
+        if (m_fetchPending) {
+            fetchLocation();
+        }
+    });
+}
 
-    if (message.type() == QDBusMessage::ErrorMessage) {
-        qWarning() << "DBus call to start GeoClue client failed: " << message.errorMessage();
+GeoClueProperties GeoClueFind::getProperties() const {
+    if (m_fixes.isEmpty()) {
+        return GeoClueProperties();
     }
+
+    return m_fixes[(m_nextFix - 1 + m_fixes.size()) % m_fixes.size()];
 }
 
-void GeoClueFind::locationAvailable(QDBusObjectPath oldLocation, QDBusObjectPath newLocation) {
+bool GeoClueFind::getPropertiesAt(const QDateTime &time, qint64 maxDistanceMs, GeoClueProperties &properties) const {
+    qint64 closest = -1;
+
+    // The history survives pausing the client, so it can hold fixes from long
+    // before the given time
+    for (const GeoClueProperties &fix : m_fixes) {
+        const qint64 distance = std::abs(fix.Timestamp.msecsTo(time));
+        if (distance <= maxDistanceMs && (closest < 0 || distance < closest)) {
+            closest = distance;
+            properties = fix;
+        }
+    }
 
-    *m_locationObjPath = newLocation.path();
+    return closest >= 0;
+}
 
-    QDBusConnection dbusConnection = QDBusConnection::systemBus();
+void GeoClueFind::pauseClient() {
+    if (m_paused) {
+        return;
+    }
 
-    QDBusInterface locationInterface(BUS_NAME, *m_locationObjPath, "org.freedesktop.DBus.Properties", dbusConnection);
+    m_paused = true;
 
-    if (!locationInterface.isValid()) {
-        qWarning() << "D-Bus org.freedesktop.DBus.Properties interface is not valid!";
+    if (!m_configured) {
+        return;
     }
 
-    QDBusReply<QVariantMap> reply = locationInterface.call("GetAll", "org.freedesktop.GeoClue2.Location");
+    qDebug() << "Pausing Client";
+
+    // Calls on one connection are handled in order, so a Stop right behind a
+    // pending Start is fine
+    QDBusMessage stop = QDBusMessage::createMethodCall(BUS_NAME, *m_clientObjPath, "org.freedesktop.GeoClue2.Client", "Stop");
 
-    if (reply.isValid()) {
-        QVariantMap propertiesMap = reply.value();
+    call(stop, [](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "DBus call to stop GeoClue client failed: " << reply.errorMessage();
+        }
+    });
+}
 
-        m_properties->Latitude = propertiesMap.value("Latitude").toFloat();
-        m_properties->Longitude = propertiesMap.value("Longitude").toFloat();
-        m_properties->Accuracy = propertiesMap.value("Accuracy").toFloat();
-        m_properties->Altitude = propertiesMap.value("Altitude").toFloat();
-        m_properties->Speed = propertiesMap.value("Speed").toFloat();
-        m_properties->Heading = propertiesMap.value("Heading").toFloat();
-        m_properties->Description = propertiesMap.value("Description").toString();
-    } else {
-        qWarning() << "Failed to get properties:" << reply.error().message();
+void GeoClueFind::resumeClient() {
+    if (!m_paused) {
+        return;
     }
 
-    emit locationUpdated();
-}
+    m_paused = false;
 
-GeoClueProperties GeoClueFind::getProperties() const {
-    return *m_properties;
+    if (!m_configured) {
+        return;
+    }
+
+    qDebug() << "Resuming Client";
+    startClient();
 }
 
 void GeoClueFind::stopClient() {
@@ -126,24 +252,20 @@ void GeoClueFind::stopClient() {
     qDebug() << "Stopping Client";
 
     if (m_clientObjPath->isEmpty()) {
-        // if we try to remove an empty object path, it could lead to a seg fault
-        qDebug() << "Failed to destroy object path: object path is invalid: " << *m_clientObjPath;
+        // GetClient has not answered yet, the client is deleted as soon as it does
+        m_stopRequested = true;
         return;
     }
 
-    QDBusConnection dbusConnection = QDBusConnection::systemBus();
-
-    QDBusInterface managerInterface(BUS_NAME, MANAGER_PATH, "org.freedesktop.GeoClue2.Manager", dbusConnection);
-    if (!managerInterface.isValid()) {
-        qWarning() << "Geoclue D-Bus org.freedesktop.GeoClue2.Manager interface is not valid!";
-        return;
-    }
-
-    QDBusReply<void> reply = managerInterface.call("DeleteClient", QDBusObjectPath(*m_clientObjPath));
-    if (!reply.isValid()) {
-        qWarning() << "D-Bus DeleteClient call failed: " << reply.error().message();
-    } else {
-        qDebug() << "GeoClue Client: " << *m_clientObjPath << "deleted";
-        emit clientDeleted();
-    }
+    QDBusMessage deleteClient = QDBusMessage::createMethodCall(BUS_NAME, MANAGER_PATH, "org.freedesktop.GeoClue2.Manager", "DeleteClient");
+    deleteClient << QVariant::fromValue(QDBusObjectPath(*m_clientObjPath));
+
+    call(deleteClient, [this](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "D-Bus DeleteClient call failed: " << reply.errorMessage();
+        } else {
+            qDebug() << "GeoClue Client: " << *m_clientObjPath << "deleted";
+            emit clientDeleted();
+        }
+    });
 }
@@ -14,10 +14,9 @@
 #include <QVariantMap>
 #include <QStringList>
 #include <QDBusReply>
-
-struct Timestamp {
-    int time1, time2;
-};
+#include <QDateTime>
+#include <QVector>
+#include <functional>
 
 struct GeoClueProperties {
     float Latitude;
@@ -27,9 +26,12 @@ struct GeoClueProperties {
     float Speed;
     float Heading;
     QString Description;
-    Timestamp timestamp;
+    // When the fix was taken, as reported by GeoClue
+    QDateTime Timestamp;
 };
 
+// Starting the client takes several calls to GeoClue, all of them are made
+// asynchronously and ready() or failed() tells how it went
 class GeoClueFind : public QObject
 {
     Q_OBJECT
@@ -40,9 +42,18 @@ public:
     void getGeoclueClient();
     void setClientInterface();
     void stopClient();
+    // Stop and Start the same client, keeping it registered with GeoClue
+    void pauseClient();
+    void resumeClient();
+    // Latest fix
     GeoClueProperties getProperties() const;
+    // Fix from the history taken closest to the given time, false if there is
+    // none within maxDistanceMs of it
+    bool getPropertiesAt(const QDateTime &time, qint64 maxDistanceMs, GeoClueProperties &properties) const;
 
 signals:
+    void ready();
+    void failed(const QString &reason);
     void locationUpdated();
     void clientDeleted();
 
@@ -50,9 +61,20 @@ public slots:
     void locationAvailable(QDBusObjectPath oldLocation, QDBusObjectPath newLocations);
 
 private:
-    GeoClueProperties* m_properties;
+    void call(const QDBusMessage &message, std::function<void(const QDBusMessage &)> onReply);
+    void startClient();
+    void fetchLocation();
+
+    QVector<GeoClueProperties> m_fixes;
+    int m_nextFix;
+    bool m_fetching;
+    bool m_fetchPending;
     QString* m_clientObjPath;
     QString* m_locationObjPath;
+    bool m_stopRequested;
+    // Properties are set and Start may be called
+    bool m_configured;
+    bool m_paused;
 };
 
 #endif // GEOCLUEFIND_H
\ No newline at end of file
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "iconcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QImageReader>
+#include <QSaveFile>
+#include <sys/time.h>
+
+// Size used when QML gives none, the icons are all drawn on a 48 px grid
+#define DEFAULT_ICON_SIZE 48
+// Files that were not used for this many days are removed at exit
+#define UNUSED_ICON_DAYS 30
+
+IconCache::IconCache(const QString &cacheDir)
+    : QQuickImageProvider(QQuickImageProvider::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading),
+      m_cacheDir(cacheDir)
+{
+    QDir().mkpath(m_cacheDir);
+}
+
+IconCache::~IconCache()
+{
+    const QDateTime oldest = QDateTime::currentDateTime().addDays(-UNUSED_ICON_DAYS);
+    const QDir cacheDir(m_cacheDir);
+
+    for (const QFileInfo &file : cacheDir.entryInfoList({"*.png"}, QDir::Files)) {
+        if (file.lastModified() < oldest) {
+            QFile::remove(file.filePath());
+        }
+    }
+}
+
+QImage IconCache::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    const QSize pixelSize(requestedSize.width() > 0 ? requestedSize.width() : DEFAULT_ICON_SIZE,
+                          requestedSize.height() > 0 ? requestedSize.height() : DEFAULT_ICON_SIZE);
+
+    const QString sourcePath = ":/icons/" + id;
+    const QByteArray hash = sourceHash(sourcePath);
+    if (hash.isEmpty()) {
+        qDebug() << "No icon" << id;
+        return QImage();
+    }
+
+    const QByteArray key = QCryptographicHash::hash(hash + QByteArray::number(pixelSize.width()) + "x"
+                                                    + QByteArray::number(pixelSize.height()),
+                                                    QCryptographicHash::Sha1).toHex();
+    const QString cachePath = m_cacheDir + "/" + key + ".png";
+
+    QImage image(cachePath);
+    if (!image.isNull()) {
+        // Marks it as used for the pruning in the destructor
+        ::utimes(QFile::encodeName(cachePath).constData(), nullptr);
+    } else {
+        image = rasterize(sourcePath, pixelSize);
+
+        // Uncompressed, decoding is what later starts pay for
+        QSaveFile file(cachePath);
+        if (!image.isNull() && file.open(QIODevice::WriteOnly) && image.save(&file, "PNG", 100)) {
+            file.commit();
+        }
+    }
+
+    if (size) {
+        *size = image.size();
+    }
+    return image;
+}
+
+QImage IconCache::rasterize(const QString &sourcePath, const QSize &requestedSize)
+{
+    QImageReader reader(sourcePath);
+    const QSize naturalSize = reader.size();
+
+    // Keeps the aspect ratio of the SVG inside the requested box, like Image.PreserveAspectFit
+    reader.setScaledSize(naturalSize.isValid() ? naturalSize.scaled(requestedSize, Qt::KeepAspectRatio) : requestedSize);
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qDebug() << "Can't rasterize" << sourcePath << reader.errorString();
+        return image;
+    }
+
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+QByteArray IconCache::sourceHash(const QString &sourcePath)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_sourceHashes.constFind(sourcePath);
+    if (it != m_sourceHashes.constEnd()) {
+        return it.value();
+    }
+
+    QFile source(sourcePath);
+    QByteArray hash;
+    if (source.open(QIODevice::ReadOnly)) {
+        hash = QCryptographicHash::hash(source.readAll(), QCryptographicHash::Sha1);
+    }
+
+    m_sourceHashes.insert(sourcePath, hash);
+    return hash;
+}
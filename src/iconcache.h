@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QQuickImageProvider>
+
+// Serves image://icons/<name>.svg from :/icons, rasterized once per size.
+// The results are kept as PNG files named after a hash of the SVG and the
+// size, so later starts skip parsing the SVG altogether.
+class IconCache : public QQuickImageProvider
+{
+public:
+    explicit IconCache(const QString &cacheDir);
+    // Removes the files no run has used for a while, such as those of icons
+    // that changed or sizes that are no longer asked for
+    ~IconCache();
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private:
+    QImage rasterize(const QString &sourcePath, const QSize &requestedSize);
+    QByteArray sourceHash(const QString &sourcePath);
+
+    QString m_cacheDir;
+    QMutex m_mutex;
+    // SVG path to the hash of its contents, read once
+    QHash<QString, QByteArray> m_sourceHashes;
+};
+
+#endif // ICONCACHE_H
@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "inventoryscanner.h"
+#include "zxingreader.h"
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QDebug>
+
+// Tiles are small enough for ZXing to find codes that only cover a few percent of
+// a 12MP shelf shot, and overlap by more than the size of a shelf label so every
+// code is whole in at least one tile
+#define TILE_SIZE 1024
+#define TILE_OVERLAP 320
+#define OVERVIEW_SIZE 1280
+
+struct InventoryTile {
+    QImage gray;
+    QRect region;
+    // From the tile's image to the full resolution still
+    double scale;
+};
+
+static QList<InventoryCode> decodeTile(const InventoryTile &tile)
+{
+    using namespace ZXing;
+
+    const QImage &gray = tile.gray;
+    const QRect &region = tile.region;
+    const uchar *data = gray.constBits() + region.y() * gray.bytesPerLine() + region.x();
+    ImageView view(data, region.width(), region.height(), ImageFormat::Lum, gray.bytesPerLine());
+
+    ReaderOptions options;
+    options.setTryHarder(true);
+    options.setTryRotate(true);
+
+    QList<InventoryCode> codes;
+    for (const ZXingQt::Result &result : ZXingQt::QListResults(ReadBarcodes(view, options))) {
+        InventoryCode code;
+        code.text = result.text();
+        code.format = result.formatName();
+        for (int i = 0; i < 4; i++) {
+            code.position << (result.position()[i] + region.topLeft()) * tile.scale;
+        }
+        codes.append(code);
+    }
+
+    return codes;
+}
+
+static QList<QRect> tileImage(const QSize &size)
+{
+    QList<QRect> tiles;
+    const int step = TILE_SIZE - TILE_OVERLAP;
+
+    for (int y = 0; ; y += step) {
+        const int top = std::max(0, std::min(y, size.height() - TILE_SIZE));
+        for (int x = 0; ; x += step) {
+            const int left = std::max(0, std::min(x, size.width() - TILE_SIZE));
+            tiles.append(QRect(left, top, TILE_SIZE, TILE_SIZE).intersected(QRect(QPoint(0, 0), size)));
+            if (left + TILE_SIZE >= size.width())
+                break;
+        }
+        if (top + TILE_SIZE >= size.height())
+            break;
+    }
+
+    return tiles;
+}
+
+static void collectCodes(QList<InventoryCode> &codes, const QList<InventoryCode> &tileCodes)
+{
+    codes.append(tileCodes);
+}
+
+// The same code seen by two overlapping tiles decodes to the same text in the same
+// place, identical labels elsewhere on the shelf are kept
+QList<InventoryCode> InventoryScanner::removeDuplicates(const QList<InventoryCode> &codes)
+{
+    QList<InventoryCode> unique;
+
+    for (const InventoryCode &code : codes) {
+        const QRect bounds = code.position.boundingRect();
+        bool duplicate = false;
+
+        for (const InventoryCode &other : unique) {
+            if (other.text == code.text && other.format == code.format && other.position.boundingRect().intersects(bounds)) {
+                duplicate = true;
+                break;
+            }
+        }
+
+        if (!duplicate)
+            unique.append(code);
+    }
+
+    return unique;
+}
+
+InventoryScanner::InventoryScanner(QObject *parent) : QObject(parent) {
+    connect(&m_loadWatcher, &QFutureWatcher<QImage>::finished, this, &InventoryScanner::onImageLoaded);
+    connect(&m_watcher, &QFutureWatcher<QList<InventoryCode>>::finished, this, &InventoryScanner::onScanFinished);
+}
+
+InventoryScanner::~InventoryScanner() {
+    m_loadWatcher.waitForFinished();
+    m_watcher.waitForFinished();
+}
+
+bool InventoryScanner::busy() const {
+    return m_loadWatcher.isRunning() || m_watcher.isRunning();
+}
+
+void InventoryScanner::scanImage(const QString &fileUrl, const QString &exportFormat) {
+    QString path = fileUrl;
+    int colonIndex = path.indexOf(':');
+
+    if (colonIndex != -1) {
+        path.remove(0, colonIndex + 1);
+    }
+
+    if (busy()) {
+        m_queue.append(qMakePair(path, exportFormat));
+        return;
+    }
+
+    m_imagePath = path;
+    m_exportFormat = exportFormat;
+    m_loadWatcher.setFuture(QtConcurrent::run(&InventoryScanner::loadImage, path));
+    emit busyChanged();
+}
+
+QImage InventoryScanner::loadImage(const QString &path) {
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+
+    const QImage gray = reader.read().convertToFormat(QImage::Format_Grayscale8);
+    if (gray.isNull()) {
+        qWarning() << "Inventory scan: can't read image" << path << reader.errorString();
+    }
+    return gray;
+}
+
+QFuture<QList<InventoryCode>> InventoryScanner::decodeTiles(const QImage &gray) {
+    QList<InventoryTile> tiles;
+
+    if (!gray.isNull()) {
+        for (const QRect &region : tileImage(gray.size())) {
+            tiles.append({gray, region, 1.0});
+        }
+
+        // Codes larger than a tile are only whole in a downscaled view of the full image
+        const QImage overview = gray.scaled(gray.size().boundedTo(QSize(OVERVIEW_SIZE, OVERVIEW_SIZE)), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        tiles.append({overview, overview.rect(), double(gray.width()) / overview.width()});
+    }
+
+    // A pool thread waiting on nested tile jobs would sit idle and could leave
+    // none free for them, so every tile is its own job and the codes are
+    // gathered as they finish
+    return QtConcurrent::mappedReduced<QList<InventoryCode>>(tiles, decodeTile, collectCodes, QtConcurrent::OrderedReduce);
+}
+
+QList<InventoryCode> InventoryScanner::decodeImage(const QImage &gray) {
+    return removeDuplicates(decodeTiles(gray).result());
+}
+
+void InventoryScanner::onImageLoaded() {
+    m_watcher.setFuture(decodeTiles(m_loadWatcher.result()));
+}
+
+void InventoryScanner::onScanFinished() {
+    const QList<InventoryCode> codes = removeDuplicates(m_watcher.result());
+    const QFileInfo image(m_imagePath);
+    const QString suffix = m_exportFormat == "csv" ? "csv" : "json";
+    const QString exportPath = image.absolutePath() + "/" + image.completeBaseName() + ".codes." + suffix;
+
+    qDebug() << "Inventory scan found" << codes.size() << "codes in" << m_imagePath;
+
+    if (!exportCodes(codes, exportPath, suffix)) {
+        qWarning() << "Failed to write inventory export" << exportPath;
+        emit scanFinished(m_imagePath, codes.size(), QString());
+    } else {
+        emit scanFinished(m_imagePath, codes.size(), exportPath);
+    }
+
+    if (!m_queue.isEmpty()) {
+        QPair<QString, QString> next = m_queue.takeFirst();
+        scanImage(next.first, next.second);
+    } else {
+        emit busyChanged();
+    }
+}
+
+bool InventoryScanner::exportCodes(const QList<InventoryCode> &codes, const QString &exportPath, const QString &exportFormat) {
+    QSaveFile file(exportPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    if (exportFormat == "csv") {
+        QTextStream out(&file);
+        out << "text,format,x1,y1,x2,y2,x3,y3,x4,y4\n";
+
+        for (const InventoryCode &code : codes) {
+            QString text = code.text;
+            out << '"' << text.replace('"', "\"\"") << "\"," << code.format;
+            for (const QPoint &point : code.position) {
+                out << ',' << point.x() << ',' << point.y();
+            }
+            out << '\n';
+        }
+        out.flush();
+    } else {
+        QJsonArray entries;
+
+        for (const InventoryCode &code : codes) {
+            QJsonArray points;
+            for (const QPoint &point : code.position) {
+                points.append(QJsonArray{point.x(), point.y()});
+            }
+
+            entries.append(QJsonObject{
+                {"text", code.text},
+                {"format", code.format},
+                {"position", points},
+            });
+        }
+
+        QJsonObject root{
+            {"image", QFileInfo(m_imagePath).fileName()},
+            {"codes", entries},
+        };
+
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    return file.commit();
+}
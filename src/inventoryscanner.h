@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef INVENTORYSCANNER_H
+#define INVENTORYSCANNER_H
+
+#include <QObject>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QPolygon>
+#include <QString>
+#include <QList>
+
+struct InventoryCode {
+    QString text;
+    QString format;
+    QPolygon position;
+};
+
+class InventoryScanner : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+
+public:
+    explicit InventoryScanner(QObject *parent = nullptr);
+    ~InventoryScanner();
+
+    // Decodes every code in a full resolution still and writes them next to it,
+    // exportFormat is "json" or "csv"
+    Q_INVOKABLE void scanImage(const QString &fileUrl, const QString &exportFormat = QString("json"));
+
+    bool busy() const;
+
+    // The still in grayscale, a null image if it can't be read
+    static QImage loadImage(const QString &path);
+    // Decodes the tiles and an overview of the image on the global thread pool.
+    // Must not be called from a pool thread, the result still holds the codes
+    // that overlapping tiles found twice.
+    static QFuture<QList<InventoryCode>> decodeTiles(const QImage &gray);
+    // Blocks until decodeTiles is done, without the duplicates
+    static QList<InventoryCode> decodeImage(const QImage &gray);
+    static QList<InventoryCode> removeDuplicates(const QList<InventoryCode> &codes);
+
+signals:
+    void busyChanged();
+    void scanFinished(const QString &imagePath, int count, const QString &exportPath);
+
+private slots:
+    void onImageLoaded();
+    void onScanFinished();
+
+private:
+    bool exportCodes(const QList<InventoryCode> &codes, const QString &exportPath, const QString &exportFormat);
+
+    QFutureWatcher<QImage> m_loadWatcher;
+    QFutureWatcher<QList<InventoryCode>> m_watcher;
+    QString m_imagePath;
+    QString m_exportFormat;
+    QList<QPair<QString, QString>> m_queue;
+};
+
+#endif // INVENTORYSCANNER_H
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <atomic>
+
+// Fixed power-of-two millisecond buckets, cheap enough to record from the
+// decoder threads on every frame and read from the GUI thread at any time.
+class LatencyHistogram
+{
+public:
+    // Upper bounds in ms, the last bucket collects everything above 1024 ms and
+    // has no bound, reported as -1
+    static constexpr int BucketCount = 12;
+    static constexpr int bucketBound(int i) { return i < BucketCount - 1 ? 1 << i : -1; }
+
+    LatencyHistogram() { reset(); }
+
+    void record(qint64 nsecs)
+    {
+        if (nsecs < 0)
+            nsecs = 0;
+
+        int bucket = 0;
+        while (bucket < BucketCount - 1 && nsecs > qint64(bucketBound(bucket)) * 1000000)
+            bucket++;
+
+        m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(nsecs, std::memory_order_relaxed);
+
+        qint64 max = m_max.load(std::memory_order_relaxed);
+        while (nsecs > max && !m_max.compare_exchange_weak(max, nsecs, std::memory_order_relaxed)) {}
+    }
+
+    void reset()
+    {
+        for (auto &bucket : m_buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the given percentile, in ms, -1 when
+    // that is the open-ended last bucket
+    int percentile(double p) const
+    {
+        const quint64 total = count();
+        if (total == 0)
+            return 0;
+
+        quint64 seen = 0;
+        for (int i = 0; i < BucketCount; i++) {
+            seen += m_buckets[i].load(std::memory_order_relaxed);
+            if (seen >= total * p)
+                return bucketBound(i);
+        }
+        return bucketBound(BucketCount - 1);
+    }
+
+    QVariantMap toVariantMap() const
+    {
+        const quint64 total = count();
+        QVariantList buckets;
+        QVariantList bounds;
+
+        for (int i = 0; i < BucketCount; i++) {
+            buckets << m_buckets[i].load(std::memory_order_relaxed);
+            bounds << bucketBound(i);
+        }
+
+        return QVariantMap{
+            {"count", total},
+            {"meanMs", total ? m_sum.load(std::memory_order_relaxed) / 1e6 / total : 0.0},
+            {"maxMs", m_max.load(std::memory_order_relaxed) / 1e6},
+            {"p50Ms", percentile(0.5)},
+            {"p90Ms", percentile(0.9)},
+            {"p99Ms", percentile(0.99)},
+            {"bucketBoundsMs", bounds},
+            {"buckets", buckets},
+        };
+    }
+
+    QString summary() const
+    {
+        const quint64 total = count();
+        return QString("n=%1 mean=%2ms p50%3ms p90%4ms p99%5ms max=%6ms")
+            .arg(total)
+            .arg(total ? m_sum.load(std::memory_order_relaxed) / 1e6 / total : 0.0, 0, 'f', 2)
+            .arg(percentileText(0.5))
+            .arg(percentileText(0.9))
+            .arg(percentileText(0.99))
+            .arg(m_max.load(std::memory_order_relaxed) / 1e6, 0, 'f', 2);
+    }
+
+private:
+    QString percentileText(double p) const
+    {
+        const int bound = percentile(p);
+        return bound < 0 ? QString(">%1").arg(bucketBound(BucketCount - 2)) : QString("<=%1").arg(bound);
+    }
+
+    std::atomic<quint64> m_buckets[BucketCount];
+    std::atomic<quint64> m_count;
+    std::atomic<qint64> m_sum;
+    std::atomic<qint64> m_max;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -8,28 +8,49 @@
 // Alexander Rutz <alex@familyrutz.com>
 // Joaquin Philco <joaquinphilco@gmail.com>
 
-#include <QApplication>
+#include <QCommandLineParser>
 #include <QIcon>
 #include <QFont>
+#ifdef USE_QT_WIDGETS
+#include <QApplication>
 #include <QSystemTrayIcon>
 #include <QMenu>
+#else
+#include <QGuiApplication>
+#include "statusnotifieritem.h"
+#endif
 #include "singleinstance.h"
 #include "appcontroller.h"
+#include "startuptimeline.h"
 
 int main(int argc, char *argv[])
 {
+    StartupTimeline::instance().mark("main");
+
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 #endif
+#ifdef USE_QT_WIDGETS
     QApplication app(argc, argv);
+#else
+    QGuiApplication app(argc, argv);
+#endif
     app.setOrganizationName("FuriOS");
     app.setOrganizationDomain("furios.io");
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { StartupTimeline::instance().flush(); });
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("intent", "Mode to start in: photo, video, scan or timer=<seconds>", "[intent]");
+    parser.process(app);
+    const QString intent = parser.positionalArguments().value(0);
 
     SingleInstance singleInstance;
-    if (!singleInstance.listen("FuriOSCameraApp")) {
+    if (!singleInstance.listen("FuriOSCameraApp", intent)) {
         qDebug() << "Application already running";
         return 0;
     }
+    StartupTimeline::instance().mark("singleInstanceListen");
 
     QIcon::setThemeName("default");
     QIcon::setThemeSearchPaths(QStringList("/usr/share/icons"));
@@ -39,6 +60,7 @@ int main(int argc, char *argv[])
 
     AppController appController(app);
 
+#ifdef USE_QT_WIDGETS
     QSystemTrayIcon trayIcon(QIcon("/usr/share/icons/camera-app.svg"), &app);
     QMenu trayMenu;
     QAction quitAction("Quit");
@@ -46,13 +68,26 @@ int main(int argc, char *argv[])
     trayMenu.addAction(&quitAction);
     trayIcon.setContextMenu(&trayMenu);
     trayIcon.show();
+#else
+    // Only published when something shows trays, most phone compositors don't
+    StatusNotifierItem trayItem("camera-app", "/usr/share/icons");
+    QObject::connect(&trayItem, &StatusNotifierItem::activateRequested, &appController, &AppController::showWindow);
+    QObject::connect(&trayItem, &StatusNotifierItem::quitRequested, &app, &QCoreApplication::quit);
+    trayItem.registerWhenHostAvailable();
+#endif
 
     QObject::connect(&singleInstance, &SingleInstance::showWindow, &appController, &AppController::showWindow);
+    QObject::connect(&singleInstance, &SingleInstance::actionRequested, &appController, &AppController::activateAction);
 
     appController.initialize();
     appController.initializeSettings();
-    appController.createDirectories();
-    appController.restartGpsIfNeeded();
+    StartupTimeline::instance().mark("settingsLoaded");
+
+    QString action;
+    QVariant parameter;
+    if (SingleInstance::parseIntent(intent, &action, &parameter)) {
+        appController.activateAction(action, parameter);
+    }
 
     return app.exec();
 }
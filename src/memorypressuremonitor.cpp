@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "memorypressuremonitor.h"
+#include <QDebug>
+#include <QSocketNotifier>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+MemoryPressureMonitor::MemoryPressureMonitor(QObject *parent)
+    : QObject(parent), m_fd(-1), m_notifier(nullptr)
+{
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    stop();
+}
+
+bool MemoryPressureMonitor::start(int stallUs, int windowUs)
+{
+    if (m_fd >= 0) {
+        return true;
+    }
+
+    m_fd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (m_fd < 0) {
+        qDebug() << "No memory pressure information:" << strerror(errno);
+        return false;
+    }
+
+    // Unprivileged triggers need a window that is a multiple of 2 s
+    const QByteArray trigger = QString("some %1 %2").arg(stallUs).arg(windowUs).toLatin1();
+    if (write(m_fd, trigger.constData(), trigger.size() + 1) < 0) {
+        qDebug() << "Memory pressure trigger refused:" << strerror(errno);
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    // The trigger fires as POLLPRI
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Exception, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &MemoryPressureMonitor::onActivated);
+    return true;
+}
+
+void MemoryPressureMonitor::stop()
+{
+    delete m_notifier;
+    m_notifier = nullptr;
+
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool MemoryPressureMonitor::isActive() const
+{
+    return m_fd >= 0;
+}
+
+void MemoryPressureMonitor::onActivated()
+{
+    emit pressure();
+}
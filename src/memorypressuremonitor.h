@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef MEMORYPRESSUREMONITOR_H
+#define MEMORYPRESSUREMONITOR_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+// Waits on a PSI trigger in /proc/pressure/memory. The kernel wakes us when
+// tasks have stalled on memory for longer than the threshold within the
+// window, there is no polling.
+class MemoryPressureMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MemoryPressureMonitor(QObject *parent = nullptr);
+    ~MemoryPressureMonitor();
+
+    // False when the kernel has no PSI or refuses the trigger
+    bool start(int stallUs = 150000, int windowUs = 2000000);
+    void stop();
+    bool isActive() const;
+
+signals:
+    void pressure();
+
+private slots:
+    void onActivated();
+
+private:
+    int m_fd;
+    QSocketNotifier *m_notifier;
+};
+
+#endif // MEMORYPRESSUREMONITOR_H
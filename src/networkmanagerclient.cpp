@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "networkmanagerclient.h"
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusObjectPath>
+#include <QDBusPendingCallWatcher>
+#include <QDBusServiceWatcher>
+#include <QDebug>
+
+#define NM_SERVICE "org.freedesktop.NetworkManager"
+#define NM_PATH "/org/freedesktop/NetworkManager"
+#define NM_DEVICE_INTERFACE "org.freedesktop.NetworkManager.Device"
+#define NM_WIRELESS_INTERFACE "org.freedesktop.NetworkManager.Device.Wireless"
+#define NM_ACCESS_POINT_INTERFACE "org.freedesktop.NetworkManager.AccessPoint"
+#define DBUS_PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
+// NM_DEVICE_TYPE_WIFI
+#define DEVICE_TYPE_WIFI 2
+
+NetworkManagerClient::NetworkManagerClient(QObject *parent) : QObject(parent), m_pendingLoads(0), m_ready(false), m_generation(0) {
+    QDBusConnection bus = QDBusConnection::systemBus();
+
+    // An empty path subscribes to the signal on every object of the service
+    bus.connect(NM_SERVICE, QString(), DBUS_PROPERTIES_INTERFACE, "PropertiesChanged",
+                this, SLOT(onPropertiesChanged(QDBusMessage)));
+    bus.connect(NM_SERVICE, NM_PATH, NM_SERVICE, "DeviceAdded", this, SLOT(onDeviceAdded(QDBusObjectPath)));
+    bus.connect(NM_SERVICE, NM_PATH, NM_SERVICE, "DeviceRemoved", this, SLOT(onDeviceRemoved(QDBusObjectPath)));
+    bus.connect(NM_SERVICE, QString(), NM_WIRELESS_INTERFACE, "AccessPointAdded",
+                this, SLOT(onAccessPointAdded(QDBusMessage)));
+    bus.connect(NM_SERVICE, QString(), NM_WIRELESS_INTERFACE, "AccessPointRemoved",
+                this, SLOT(onAccessPointRemoved(QDBusMessage)));
+
+    m_watcher = new QDBusServiceWatcher(NM_SERVICE, bus, QDBusServiceWatcher::WatchForOwnerChange, this);
+    connect(m_watcher, &QDBusServiceWatcher::serviceOwnerChanged, this, &NetworkManagerClient::onServiceOwnerChanged);
+
+    reload();
+}
+
+bool NetworkManagerClient::isReady() const {
+    return m_ready;
+}
+
+bool NetworkManagerClient::wirelessEnabled() const {
+    return cachedProperty(NM_PATH, NM_SERVICE, "WirelessEnabled").toBool();
+}
+
+QStringList NetworkManagerClient::wifiDevices() const {
+    return m_devices;
+}
+
+QStringList NetworkManagerClient::accessPoints(const QString &device) const {
+    return m_accessPoints.value(device);
+}
+
+QString NetworkManagerClient::accessPointSsid(const QString &accessPoint) const {
+    return QString::fromUtf8(cachedProperty(accessPoint, NM_ACCESS_POINT_INTERFACE, "Ssid").toByteArray());
+}
+
+quint8 NetworkManagerClient::accessPointStrength(const QString &accessPoint) const {
+    return cachedProperty(accessPoint, NM_ACCESS_POINT_INTERFACE, "Strength").toUInt();
+}
+
+QString NetworkManagerClient::findAccessPoint(const QString &ssid) const {
+    QString best;
+    int bestStrength = -1;
+
+    for (const QString &device : m_devices) {
+        for (const QString &accessPoint : m_accessPoints.value(device)) {
+            if (accessPointSsid(accessPoint) == ssid && accessPointStrength(accessPoint) > bestStrength) {
+                best = accessPoint;
+                bestStrength = accessPointStrength(accessPoint);
+            }
+        }
+    }
+
+    return best;
+}
+
+QVariant NetworkManagerClient::cachedProperty(const QString &path, const QString &interface, const QString &name) const {
+    return m_properties.value(qMakePair(path, interface)).value(name);
+}
+
+void NetworkManagerClient::reload() {
+    m_generation++;
+    m_properties.clear();
+    m_accessPoints.clear();
+    m_devices.clear();
+    m_pendingLoads = 0;
+
+    loadProperties(NM_PATH, NM_SERVICE);
+}
+
+void NetworkManagerClient::loadProperties(const QString &path, const QString &interface) {
+    QDBusMessage getAll = QDBusMessage::createMethodCall(NM_SERVICE, path, DBUS_PROPERTIES_INTERFACE, "GetAll");
+    getAll << interface;
+
+    const quint32 generation = m_generation;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(getAll), this);
+    m_pendingLoads++;
+
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, path, interface, generation](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+
+        if (generation != m_generation) {
+            return;
+        }
+
+        const QDBusMessage reply = watcher->reply();
+
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "NetworkManager: failed to load" << path << interface << reply.errorMessage();
+        } else {
+            const QVariantMap properties = qdbus_cast<QVariantMap>(reply.arguments().value(0));
+            m_properties.insert(qMakePair(path, interface), properties);
+            emit propertiesChanged(path, interface, properties.keys());
+
+            if (path == NM_PATH && interface == NM_SERVICE) {
+                emit wirelessEnabledChanged();
+                for (const QDBusObjectPath &device : qdbus_cast<QList<QDBusObjectPath>>(properties.value("Devices"))) {
+                    loadDevice(device.path());
+                }
+            } else if (interface == NM_DEVICE_INTERFACE && properties.value("DeviceType").toUInt() == DEVICE_TYPE_WIFI) {
+                loadProperties(path, NM_WIRELESS_INTERFACE);
+            } else if (interface == NM_WIRELESS_INTERFACE) {
+                if (!m_devices.contains(path)) {
+                    m_devices.append(path);
+                    emit devicesChanged();
+                }
+                for (const QDBusObjectPath &accessPoint : qdbus_cast<QList<QDBusObjectPath>>(properties.value("AccessPoints"))) {
+                    loadAccessPoint(path, accessPoint.path());
+                }
+            }
+        }
+
+        loadFinished();
+    });
+}
+
+void NetworkManagerClient::loadDevice(const QString &device) {
+    loadProperties(device, NM_DEVICE_INTERFACE);
+}
+
+void NetworkManagerClient::loadAccessPoint(const QString &device, const QString &accessPoint) {
+    QStringList &accessPoints = m_accessPoints[device];
+    if (accessPoints.contains(accessPoint)) {
+        return;
+    }
+
+    accessPoints.append(accessPoint);
+    loadProperties(accessPoint, NM_ACCESS_POINT_INTERFACE);
+}
+
+void NetworkManagerClient::loadFinished() {
+    if (--m_pendingLoads == 0 && !m_ready) {
+        m_ready = true;
+        emit ready();
+    }
+}
+
+void NetworkManagerClient::removeObject(const QString &path) {
+    for (auto it = m_properties.begin(); it != m_properties.end(); ) {
+        if (it.key().first == path) {
+            it = m_properties.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void NetworkManagerClient::onPropertiesChanged(const QDBusMessage &message) {
+    const QString interface = message.arguments().value(0).toString();
+    auto cached = m_properties.find(qMakePair(message.path(), interface));
+
+    // Objects we never loaded are not tracked
+    if (cached == m_properties.end()) {
+        return;
+    }
+
+    const QVariantMap changed = qdbus_cast<QVariantMap>(message.arguments().value(1));
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+        cached->insert(it.key(), it.value());
+    }
+
+    if (message.path() == NM_PATH && interface == NM_SERVICE && changed.contains("WirelessEnabled")) {
+        emit wirelessEnabledChanged();
+    }
+
+    emit propertiesChanged(message.path(), interface, changed.keys());
+}
+
+void NetworkManagerClient::onDeviceAdded(const QDBusObjectPath &device) {
+    loadDevice(device.path());
+}
+
+void NetworkManagerClient::onDeviceRemoved(const QDBusObjectPath &device) {
+    for (const QString &accessPoint : m_accessPoints.take(device.path())) {
+        removeObject(accessPoint);
+    }
+    removeObject(device.path());
+
+    if (m_devices.removeAll(device.path()) > 0) {
+        emit devicesChanged();
+    }
+}
+
+void NetworkManagerClient::onAccessPointAdded(const QDBusMessage &message) {
+    const QString device = message.path();
+    const QString accessPoint = qdbus_cast<QDBusObjectPath>(message.arguments().value(0)).path();
+
+    if (!m_devices.contains(device)) {
+        return;
+    }
+
+    loadAccessPoint(device, accessPoint);
+    emit accessPointAdded(device, accessPoint);
+}
+
+void NetworkManagerClient::onAccessPointRemoved(const QDBusMessage &message) {
+    const QString device = message.path();
+    const QString accessPoint = qdbus_cast<QDBusObjectPath>(message.arguments().value(0)).path();
+
+    // Any device can signal, only the ones that are tracked have an entry
+    auto it = m_accessPoints.find(device);
+    if (it != m_accessPoints.end() && it->removeAll(accessPoint) > 0) {
+        removeObject(accessPoint);
+        emit accessPointRemoved(device, accessPoint);
+    }
+}
+
+void NetworkManagerClient::onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner) {
+    Q_UNUSED(service);
+    Q_UNUSED(oldOwner);
+
+    // NetworkManager restarted, every path we know about is gone
+    qDebug() << "NetworkManager owner changed, reloading";
+    reload();
+
+    if (newOwner.isEmpty()) {
+        emit wirelessEnabledChanged();
+        emit devicesChanged();
+    }
+}
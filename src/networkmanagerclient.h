@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef NETWORKMANAGERCLIENT_H
+#define NETWORKMANAGERCLIENT_H
+
+#include <QObject>
+#include <QDBusMessage>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVariantMap>
+
+class QDBusServiceWatcher;
+
+// Long lived view of the NetworkManager objects we care about: the manager itself,
+// the Wi-Fi devices and their access points. Properties are fetched once with
+// GetAll and then kept up to date from PropertiesChanged and the added/removed
+// signals, so reads never go over the bus. Calls are built as plain messages
+// rather than through QDBusInterface, which would introspect every object.
+class NetworkManagerClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NetworkManagerClient(QObject *parent = nullptr);
+
+    // True once the initial state has been loaded
+    bool isReady() const;
+
+    bool wirelessEnabled() const;
+    QStringList wifiDevices() const;
+    QStringList accessPoints(const QString &device) const;
+    QString accessPointSsid(const QString &accessPoint) const;
+    quint8 accessPointStrength(const QString &accessPoint) const;
+    // Strongest access point broadcasting the SSID on any Wi-Fi device, or empty
+    QString findAccessPoint(const QString &ssid) const;
+
+    QVariant cachedProperty(const QString &path, const QString &interface, const QString &name) const;
+
+signals:
+    void ready();
+    // Also emitted with every name when an object's properties are first loaded
+    void propertiesChanged(const QString &path, const QString &interface, const QStringList &names);
+    void wirelessEnabledChanged();
+    void devicesChanged();
+    void accessPointAdded(const QString &device, const QString &accessPoint);
+    void accessPointRemoved(const QString &device, const QString &accessPoint);
+
+private slots:
+    void onPropertiesChanged(const QDBusMessage &message);
+    void onDeviceAdded(const QDBusObjectPath &device);
+    void onDeviceRemoved(const QDBusObjectPath &device);
+    void onAccessPointAdded(const QDBusMessage &message);
+    void onAccessPointRemoved(const QDBusMessage &message);
+    void onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
+
+private:
+    typedef QPair<QString, QString> ObjectInterface;
+
+    void reload();
+    void loadProperties(const QString &path, const QString &interface);
+    void loadDevice(const QString &device);
+    void loadAccessPoint(const QString &device, const QString &accessPoint);
+    void removeObject(const QString &path);
+    void loadFinished();
+
+    QHash<ObjectInterface, QVariantMap> m_properties;
+    QHash<QString, QStringList> m_accessPoints;
+    QStringList m_devices;
+    QDBusServiceWatcher *m_watcher;
+    int m_pendingLoads;
+    bool m_ready;
+    quint32 m_generation;
+};
+
+#endif // NETWORKMANAGERCLIENT_H
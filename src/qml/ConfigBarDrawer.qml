@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2023 Droidian Project
+// Copyright (C) 2024 Furi Labs
+//
+// Authors:
+// Bardia Moshiri <fakeshell@bardia.tech>
+// Erik Inkinen <erik.inkinen@gmail.com>
+// Alexander Rutz <alex@familyrutz.com>
+// Joaquin Philco <joaquinphilco@gmail.com>
+
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+import FuriOS.Camera 1.0
+
+Drawer {
+    id: configBarDrawer
+    property alias opened: configBar.opened
+    property alias currIndex: configBar.currIndex
+    parent: Overlay.overlay
+    height: 55 * window.scalingRatio
+    width: window.width
+    dim: false
+    edge: Qt.TopEdge
+    modal: false
+    interactive: false
+
+    visible: !configBarBtn.visible
+
+    background: Rectangle {
+        anchors.fill: parent
+        color: "transparent"
+    }
+
+    Item {
+        id: configBar
+        width: parent.width
+        height: configBarDrawer.height
+        anchors.horizontalCenter: parent.horizontalCenter
+        anchors.verticalCenter: parent.verticalCenter
+        anchors.verticalCenterOffset: 20 * window.scalingRatio
+
+        property var opened: 0;
+        property var aspectRatioOpened: 0;
+        property var currIndex: timerTumbler.currentIndex
+        visible: !window.mediaViewVisible && !window.videoCaptured
+
+        RowLayout {
+            anchors.horizontalCenter: parent.horizontalCenter
+            spacing: configBarDrawer.height * 0.8
+
+            Button {
+                icon.source: settings.soundOn === 1 ? "image://icons/audioOn.svg" : "image://icons/audioOff.svg"
+                icon.height: configBarDrawer.height * 0.6
+                icon.width: configBarDrawer.height * 0.6
+                icon.color: settings.soundOn === 1 ? "white" : "grey"
+
+                background: Rectangle {
+                    anchors.fill: parent
+                    color: "transparent"
+                }
+
+                onClicked: {
+                    settings.soundOn = settings.soundOn === 1 ? 0 : 1;
+                }
+            }
+
+            Button {
+                icon.source: window.gps_icon_source
+                icon.height: configBarDrawer.height * 0.6
+                icon.width: configBarDrawer.height * 0.6
+                icon.color: window.locationAvailable === 1 ? "white" : "grey"
+
+                background: Rectangle {
+                    anchors.fill: parent
+                    color: "transparent"
+                }
+
+                onClicked: {
+                    settings.gpsOn = settings.gpsOn === 1 ? 0 : 1;
+
+                    if (settings.gpsOn === 1) {
+                        FileManager.turnOnGps();
+                    } else {
+                        FileManager.turnOffGps();
+                        window.gps_icon_source = "image://icons/gpsOff.svg";
+                        window.locationAvailable = 0;
+                    }
+                }
+            }
+
+            Button {
+                icon.source: "image://icons/qrc.svg"
+                icon.height: configBarDrawer.height * 0.6
+                icon.width: configBarDrawer.height * 0.6
+                icon.color: settings.inventoryMode === 1 ? "white" : "grey"
+
+                background: Rectangle {
+                    anchors.fill: parent
+                    color: "transparent"
+                }
+
+                onClicked: {
+                    settings.inventoryMode = settings.inventoryMode === 1 ? 0 : 1;
+                }
+            }
+
+            Button {
+                id: timerButton
+                icon.source: "image://icons/timer.svg"
+                icon.height: configBarDrawer.height * 0.6
+                icon.width: configBarDrawer.height * 0.6
+                icon.color: "white"
+
+                background: Rectangle {
+                    anchors.fill: parent
+                    color: "transparent"
+                }
+
+                onClicked: {
+                    configBar.opened = configBar.opened === 1 ? 0 : 1
+                    configBar.aspectRatioOpened = 0
+                    optionContainer.state = "closed"
+                    window.blurView = 1
+                }
+
+                Tumbler {
+                    id: timerTumbler
+                    height: 200 * window.scalingRatio
+                    width: 50 * window.scalingRatio
+                    anchors.horizontalCenter: timerButton.horizontalCenter
+                    Layout.preferredWidth: parent.width
+                    anchors.top: timerButton.bottom
+                    model: 60
+                    visible: configBar.opened === 1 ? true : false
+                    enabled: configBar.opened === 1 ? true : false
+
+                    delegate: Text {
+                        text: modelData == 0 ? "Off" : modelData
+                        color: "white"
+                        font.bold: true
+                        font.pixelSize: 30 * window.scalingRatio
+                        font.family: "Lato Hairline"
+                        horizontalAlignment: Text.AlignHCenter
+                        opacity: 0.4 + Math.max(0, 1 - Math.abs(Tumbler.displacement)) * 0.6
+                    }
+
+                    Behavior on opacity {
+                        NumberAnimation {
+                            duration: 300
+                            easing.type: Easing.InOutQuad
+                        }
+                    }
+
+                    onVisibleChanged: {
+                        opacity = visible ? 1 : 0
+                    }
+                }
+            }
+
+            Button {
+                id: aspectRatioButton
+                icon.source: "image://icons/aspectRatioMenu.svg"
+                icon.height: configBarDrawer.height * 0.6
+                icon.width: configBarDrawer.height * 0.6
+                icon.color: "white"
+
+                background: Rectangle {
+                    anchors.fill: parent
+                    color: "transparent"
+                }
+
+                onClicked: {
+                    configBar.aspectRatioOpened = configBar.aspectRatioOpened === 1 ? 0 : 1
+                    optionContainer.state = "closed"
+                    configBar.opened = 0
+                }
+
+                ColumnLayout {
+                    id: aspectRatios
+                    anchors.top: aspectRatioButton.bottom
+                    anchors.horizontalCenter: aspectRatioButton.horizontalCenter
+                    visible: configBar.aspectRatioOpened === 1 ? true : false
+                    spacing: 5 * window.scalingRatio
+
+                    Button {
+                        id: sixteenNineButton
+                        text: "16:9"
+                        Layout.preferredWidth: 60 * window.scalingRatio
+                        font.pixelSize:  35 * window.scalingRatio * 0.5
+                        font.bold: true
+                        font.family: "Lato Hairline"
+                        palette.buttonText: camera.aspWide === 1 ? "white" : "gray"
+
+                        background: Rectangle {
+                            width: 60 * window.scalingRatio
+                            height: 35 * window.scalingRatio
+                            anchors.centerIn: parent
+                            color: "transparent"
+                            border.width: 1 * window.scalingRatio
+                            border.color: "white"
+                            radius: 6 * window.scalingRatio
+                        }
+
+                        onClicked: {
+                            camera.aspWide = 1;
+                            configBar.aspectRatioOpened = 0;
+                            camera.imageCapture.resolution = camera.firstSixteenNineResolution
+                        }
+                    }
+
+                    Button {
+                        id: fourThreeButton
+                        text: "4:3"
+                        Layout.preferredWidth: 60 * window.scalingRatio
+                        font.pixelSize:  35 * window.scalingRatio * 0.5
+                        font.bold: true
+                        font.family: "Lato Hairline"
+                        palette.buttonText: camera.aspWide === 1 ? "gray" : "white"
+
+                        background: Rectangle {
+                            width: 60 * window.scalingRatio
+                            height: 35 * window.scalingRatio
+                            anchors.centerIn: parent
+                            color: "transparent"
+                            border.width: 1 * window.scalingRatio
+                            border.color: "white"
+                            radius: 6 * window.scalingRatio
+                        }
+
+                        onClicked: {
+                            camera.aspWide = 0;
+                            configBar.aspectRatioOpened = 0;
+                            camera.imageCapture.resolution = camera.firstFourThreeResolution
+                        }
+                    }
+
+                    Behavior on opacity {
+                        NumberAnimation {
+                            duration: 300
+                            easing.type: Easing.InOutQuad
+                        }
+                    }
+
+                    onVisibleChanged: {
+                        opacity = visible ? 1 : 0
+                    }
+                }
+            }
+
+            Button {
+                id: menu
+                icon.source: "image://icons/menu.svg"
+                icon.height: configBarDrawer.height * 0.6
+                icon.width: configBarDrawer.height * 0.6
+                icon.color: "white"
+                enabled: !window.videoCaptured
+
+                background: Rectangle {
+                    anchors.fill: parent
+                    color: "transparent"
+                }
+
+                onClicked: {
+                    backCamSelect.visible = true
+                    optionContainer.state = "opened"
+                    configBarDrawer.close()
+                    window.blurView = 1
+                }
+            }
+        }
+    }
+
+    function setTimerDelay(seconds) {
+        timerTumbler.currentIndex = Math.max(0, Math.min(seconds, timerTumbler.count - 1))
+    }
+
+    onClosed: {
+        window.blurView = optionContainer.state === "opened" ? 1 : 0;
+        configBar.opened = 0;
+        configBar.aspectRatioOpened = 0;
+    }
+}
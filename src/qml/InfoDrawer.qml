@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2023 Droidian Project
+// Copyright (C) 2024 Furi Labs
+//
+// Authors:
+// Bardia Moshiri <fakeshell@bardia.tech>
+// Erik Inkinen <erik.inkinen@gmail.com>
+// Alexander Rutz <alex@familyrutz.com>
+// Joaquin Philco <joaquinphilco@gmail.com>
+
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+
+Drawer {
+    id: infoDrawer
+    parent: Overlay.overlay
+    width: window.width
+    edge: Qt.BottomEdge
+    dim: true
+    interactive: settings.hideInfoDrawer != 1
+
+    background: Rectangle {
+        anchors.fill: parent
+        color: "black"
+        opacity: 0.9
+    }
+
+    GridLayout {
+        columnSpacing: 5
+        rowSpacing: 25
+        anchors.centerIn: parent
+        width: parent.width * 0.9
+        columns: 2
+        rows: 2
+
+        Button {
+            icon.source: "image://icons/helpAboutSymbolic.svg"
+            icon.color: "lightblue"
+            icon.width: 48
+            icon.height: 48
+            Layout.preferredWidth: icon.width * 1.5
+            Layout.alignment: Qt.AlignHCenter | Qt.AlignTop
+            Layout.topMargin: 10
+
+            background: Rectangle {
+                anchors.fill: parent
+                color: "transparent"
+            }
+        }
+
+        Text {
+            Layout.alignment: Qt.AlignLeft
+            Layout.fillWidth: true
+            Layout.topMargin: 10
+            text: "Swipe down for more options"
+            horizontalAlignment: Text.AlignHCenter
+            color: "white"
+            font.pixelSize: 32
+            font.bold: true
+            style: Text.Outline;
+            styleColor: "black"
+            wrapMode: Text.WordWrap
+        }
+
+        Button {
+            icon.source: "image://icons/emblemDefaultSymbolic.svg"
+            icon.color: "white"
+            icon.width: 48
+            icon.height: 48
+            Layout.columnSpan: 2
+            Layout.alignment: Qt.AlignHCenter
+            Layout.fillWidth: true
+
+            background: Rectangle {
+                anchors.fill: parent
+                color: "transparent"
+            }
+
+            onClicked: {
+                infoDrawer.close()
+                settings.hideInfoDrawer = 1
+                settings.setValue("hideInfoDrawer", 1);
+            }
+        }
+    }
+    onClosed: {
+        window.blurView = 0;
+    }
+}
@@ -14,6 +14,7 @@ import QtQuick.Layouts 1.15
 import QtQuick.Controls 2.15
 import Qt.labs.folderlistmodel 2.15
 import Qt.labs.platform 1.1
+import FuriOS.Camera 1.0
 
 Rectangle {
     id: viewRect
@@ -38,10 +39,10 @@ Rectangle {
     visible: false
 
     Connections {
-        target: thumbnailGenerator
+        target: ThumbnailGenerator
 
         function onThumbnailGenerated(image) {
-            viewRect.lastImg = thumbnailGenerator.toQmlImage(image);
+            viewRect.lastImg = ThumbnailGenerator.toQmlImage(image);
         }
     }
 
@@ -55,7 +56,7 @@ Rectangle {
             if (imgModel.status == FolderListModel.Ready) {
                 viewRect.index = imgModel.count - 1
                 if (cslate.state == "VideoCapture" && viewRect.currentFileUrl.endsWith(".mkv")) {
-                    thumbnailGenerator.setVideoSource(viewRect.currentFileUrl)
+                    ThumbnailGenerator.setVideoSource(viewRect.currentFileUrl)
                 } else {
                     viewRect.lastImg = viewRect.currentFileUrl
                 }
@@ -70,6 +71,20 @@ Rectangle {
                           imgModel.get(viewRect.index, "fileUrl").toString().endsWith(".mkv") ? videoOutputComponent : imageComponent
     }
 
+    function showPhotoWithCode(code) {
+        var photos = BarcodeIndexer.findPhotos(code)
+
+        for (var i = photos.length - 1; i >= 0; i--) {
+            var photoIndex = imgModel.indexOf(photos[i])
+            if (photoIndex >= 0) {
+                viewRect.index = photoIndex
+                return true
+            }
+        }
+
+        return false
+    }
+
     function swipeGesture(deltaX, deltaY, swipeThreshold) {
         if (Math.abs(deltaY) > Math.abs(deltaX)) {
             if (deltaY < -swipeThreshold) { // Upward swipe
@@ -124,7 +139,7 @@ Rectangle {
                     implicitWidth: 200 * viewRect.scalingRatio
                     implicitHeight: 200 * viewRect.scalingRatio
 
-                    icon.source: "icons/emblemPhotosSymbolic.svg"
+                    icon.source: "image://icons/emblemPhotosSymbolic.svg"
                     icon.width: Math.round(200 * viewRect.scalingRatio)
                     icon.height: Math.round(200 * viewRect.scalingRatio)
                     icon.color: "#8a8a8f"
@@ -338,7 +353,7 @@ Rectangle {
 
                 Button {
                     id: playVideoButton
-                    icon.source: "icons/playVideo.svg"
+                    icon.source: "image://icons/playVideo.svg"
                     icon.color: "#f0f0f0"
                     anchors.centerIn: parent
                     anchors.horizontalCenterOffset: 2 * viewRect.scalingRatio
@@ -369,7 +384,7 @@ Rectangle {
         implicitHeight: 60 * viewRect.scalingRatio
         anchors.verticalCenter: parent.verticalCenter
         anchors.left: parent.left
-        icon.source: "icons/goPreviousSymbolic.svg"
+        icon.source: "image://icons/goPreviousSymbolic.svg"
         icon.width: Math.round(btnPrev.width * 0.5)
         icon.height: Math.round(btnPrev.height * 0.5)
         icon.color: "white"
@@ -397,7 +412,7 @@ Rectangle {
         implicitHeight: 60 * viewRect.scalingRatio
         anchors.verticalCenter: parent.verticalCenter
         anchors.right: parent.right
-        icon.source: "icons/goNextSymbolic.svg"
+        icon.source: "image://icons/goNextSymbolic.svg"
         icon.width: Math.round(btnNext.width * 0.5)
         icon.height: Math.round(btnNext.height * 0.5)
         icon.color: "white"
@@ -445,7 +460,7 @@ Rectangle {
 
                 Button {
                     id: btnClose
-                    icon.source: "icons/cameraVideoSymbolic.svg"
+                    icon.source: "image://icons/cameraVideoSymbolic.svg"
                     icon.width: parent.width * 0.13
                     icon.height: parent.height * 0.8
                     icon.color: "white"
@@ -474,7 +489,7 @@ Rectangle {
                     anchors.right: parent.right
                     anchors.rightMargin: 20 * viewRect.scalingRatio
                     anchors.verticalCenter: parent.verticalCenter
-                    icon.source: "icons/editDeleteSymbolic.svg"
+                    icon.source: "image://icons/editDeleteSymbolic.svg"
                     icon.width: parent.width * 0.1
                     icon.height: parent.width * 0.1
                     icon.color: "white"
@@ -536,7 +551,7 @@ Rectangle {
                                 height: confirmationPopup.height * 0.6
                                 onClicked: {
                                     var tempCurrUrl = viewRect.currentFileUrl
-                                    fileManager.deleteImage(tempCurrUrl)
+                                    FileManager.deleteImage(tempCurrUrl)
                                     viewRect.index = imgModel.count
                                     deletePopUp = "closed"
                                     confirmationPopup.close()
@@ -603,7 +618,7 @@ Rectangle {
                 anchors.fill: parent
 
                 Button {
-                    icon.source: "icons/cameraVideoSymbolic.svg"
+                    icon.source: "image://icons/cameraVideoSymbolic.svg"
                     icon.width: parent.width * 0.13
                     icon.height: parent.height * 0.8
                     icon.color: "white"
@@ -629,7 +644,7 @@ Rectangle {
 
                 Button {
                     id: stopVideo
-                    icon.source: "icons/pauseVideo.svg"
+                    icon.source: "image://icons/pauseVideo.svg"
                     icon.width: parent.width * 0.13
                     icon.height: parent.height * 0.7
                     icon.color: "white"
@@ -650,7 +665,7 @@ Rectangle {
 
                 Button {
                     id: muteSoundButton
-                    icon.source: !viewRect.videoAudio ? "icons/audioOn.svg" : "icons/audioOff.svg"
+                    icon.source: !viewRect.videoAudio ? "image://icons/audioOn.svg" : "image://icons/audioOff.svg"
                     icon.width: parent.width * 0.12
                     icon.height: parent.height * 0.7
                     icon.color: "white"
@@ -690,9 +705,9 @@ Rectangle {
                     return "None"
                 } else {
                     if (viewRect.currentFileUrl.endsWith(".mkv")) {
-                        return fileManager.getVideoDate(viewRect.currentFileUrl)
+                        return FileManager.getVideoDate(viewRect.currentFileUrl)
                     } else {
-                        return fileManager.getPictureDate(viewRect.currentFileUrl)
+                        return FileManager.getPictureDate(viewRect.currentFileUrl)
                     }
                 }
             }
@@ -10,6 +10,7 @@ import QtQuick.Layouts 1.15
 import QtQuick.Controls 2.15
 import Qt.labs.folderlistmodel 2.15
 import Qt.labs.platform 1.1
+import FuriOS.Camera 1.0
 
 Item {
     id: metadataViewComponent
@@ -28,20 +29,20 @@ Item {
         metadataModel.clear();
         if (url !== "") {
             if (url.endsWith(".mkv")) {
-                metadataModel.append({title: "File Type", value: fileManager.getDocumentType(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "File Size", value: fileManager.getFileSize(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "Video Dimensions", value: fileManager.getVideoDimensions(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "Codec ID", value: fileManager.getCodecId(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "File Type", value: FileManager.getDocumentType(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "File Size", value: FileManager.getFileSize(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "Video Dimensions", value: FileManager.getVideoDimensions(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "Codec ID", value: FileManager.getCodecId(url), dataHeight: avgMetadataContainerHeight});
             } else {
-                metadataModel.append({title: "Maker, Model", value: fileManager.getCameraHardware(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "Image Dimensions", value: fileManager.getDimensions(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "File Size", value: fileManager.getFileSize(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "Aperture", value: fileManager.getFStop(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "Exposure", value: fileManager.getExposure(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "ISO", value: fileManager.getISOSpeed(url), dataHeight: avgMetadataContainerHeight});
-                metadataModel.append({title: "Focal Length", value: fileManager.focalLength(url), dataHeight: avgMetadataContainerHeight});
-                if(fileManager.gpsMetadataAvailable(url)) {
-                    metadataModel.append({title: "GPS Data", value: fileManager.getGpsMetadata(url), dataHeight: 80 * scalingRatio});
+                metadataModel.append({title: "Maker, Model", value: FileManager.getCameraHardware(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "Image Dimensions", value: FileManager.getDimensions(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "File Size", value: FileManager.getFileSize(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "Aperture", value: FileManager.getFStop(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "Exposure", value: FileManager.getExposure(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "ISO", value: FileManager.getISOSpeed(url), dataHeight: avgMetadataContainerHeight});
+                metadataModel.append({title: "Focal Length", value: FileManager.focalLength(url), dataHeight: avgMetadataContainerHeight});
+                if(FileManager.gpsMetadataAvailable(url)) {
+                    metadataModel.append({title: "GPS Data", value: FileManager.getGpsMetadata(url), dataHeight: 80 * scalingRatio});
                 }
             }
         }
@@ -6,6 +6,7 @@
 // Joaquin Philco <joaquinphilco@gmail.com>
 
 import ZXing 1.0
+import FuriOS.Camera 1.0
 import QtQuick 2.15
 import QtQuick.Controls 2.15
 import QtGraphicalEffects 1.0
@@ -106,7 +107,8 @@ Item {
     BarcodeReader {
         id: barcodeReader
 
-        formats: ZXing.QRCode
+        // Decoded in rotation, one format family per frame
+        formats: ZXing.QRCode | ZXing.DataMatrix | ZXing.EAN13 | ZXing.Code128
 
         tryRotate: false
         tryHarder: false
@@ -192,6 +194,40 @@ Item {
                         isPrimary: true,
                     }
                 ], wifiID)
+            } else if (qrType === "GEO" || qrType === "TEL" || qrType === "MAILTO") {
+                var titles = { "GEO": "Open location?", "TEL": "Call number?", "MAILTO": "Write email?" }
+                openPopupFunction(titles[qrType], lastValidResult.text, [
+                    {
+                        text: "Cancel",
+                    },
+                    {
+                        text: "Copy",
+                    },
+                    {
+                        text: "Open",
+                        isPrimary: true,
+                    }
+                ], lastValidResult.text)
+            } else if (qrType === "MECARD" || qrType === "VCARD") {
+                openPopupFunction("Contact", QRCodeHandler.getContactSummary(), [
+                    {
+                        text: "Cancel",
+                    },
+                    {
+                        text: "Copy",
+                        isPrimary: true,
+                    }
+                ], lastValidResult.text)
+            } else if (BarcodeIndexer.findPhotos(lastValidResult.text).length > 0) {
+                openPopupFunction("Code found in your photos", lastValidResult.text, [
+                    {
+                        text: "Cancel",
+                    },
+                    {
+                        text: "Show photo",
+                        isPrimary: true,
+                    }
+                ], lastValidResult.text)
             }
         }
 
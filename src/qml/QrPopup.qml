@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2023 Droidian Project
+// Copyright (C) 2024 Furi Labs
+//
+// Authors:
+// Bardia Moshiri <fakeshell@bardia.tech>
+// Erik Inkinen <erik.inkinen@gmail.com>
+// Alexander Rutz <alex@familyrutz.com>
+// Joaquin Philco <joaquinphilco@gmail.com>
+
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+import QtGraphicalEffects 1.0
+import FuriOS.Camera 1.0
+
+Rectangle {
+    id: popupBackdrop
+    width: window.width
+    height: window.height
+    color: "#66000000"
+    opacity: window.popupState === "opened" ? 1 : 0
+    visible: window.popupState === "opened"
+
+    Behavior on opacity {
+        NumberAnimation {
+            duration: 125
+        }
+    }
+
+    Behavior on visible {
+        PropertyAnimation {
+            duration: 125
+        }
+    }
+
+    MouseArea {
+        anchors.fill: parent
+        onClicked: {
+            window.popupState = "closed"
+        }
+    }
+
+    TextEdit {
+        id: copyToClipboardHelper
+        opacity: 0
+        text: window.popupData
+    }
+
+    Rectangle {
+        id: popup
+        width: window.width * 0.8
+        height: window.popupResultHeight + titlePopUp.implicitHeight + popupButtonsRow.height
+        color: "#ff383838"
+        radius: 10
+        anchors.centerIn: parent
+
+        /* adwaita-like popup: big title, center-aligned text, buttons at the bottom */
+        Column {
+            anchors.horizontalCenter: parent.horizontalCenter
+            width: parent.width
+            spacing: 0
+
+            Text {
+                id: titlePopUp
+                text: window.popupTitle
+                color: "white"
+                font.pixelSize: 24
+                font.weight: Font.ExtraBold
+                horizontalAlignment: Text.AlignHCenter
+                width: parent.width
+                wrapMode: Text.WordWrap
+                topPadding: 20
+            }
+
+            Loader {
+                id: popupBodyLoader
+                width: parent.width
+                height: window.popupResultHeight
+                asynchronous: true
+                sourceComponent: window.popupTitle === "Connect to Network?" ? wifiComponent : qrTextComponent
+            }
+
+            Component {
+                id: wifiComponent
+                Item {
+                    id: wifiItem
+
+                    RowLayout {
+                        anchors.horizontalCenter: parent.horizontalCenter
+
+                        Text {
+                            id: wifiBodyPopUp
+                            text: window.popupBody
+                            color: "white"
+                            font.pixelSize: 16
+                            horizontalAlignment: Text.AlignHCenter
+                            Layout.alignment: Qt.AlignVCenter
+                            width: parent.width
+                            wrapMode: Text.Wrap
+                            padding: 10
+                            topPadding: 10
+                            bottomPadding: 25
+                        }
+
+                        Button {
+                            id: wifiButton
+                            icon.source: QRCodeHandler.signalIcon
+                            icon.color: "white"
+                            padding: 10
+                            topPadding: 10
+                            bottomPadding: 25
+                            width: 30 * window.scalingRatio
+                            height: 30 * window.scalingRatio
+                            flat: true
+
+                            Component.onCompleted: {
+                                window.popupResultHeight = 40
+                            }
+                        }
+                    }
+                }
+            }
+
+            Component {
+                id: qrTextComponent
+                Item {
+                    id: qrTextItem
+
+                    Text {
+                        id: bodyPopUp
+                        text: window.popupBody
+                        color: "white"
+                        font.pixelSize: 16
+                        horizontalAlignment: Text.AlignHCenter
+                        Layout.alignment: Qt.AlignVCenter
+                        width: parent.width
+                        wrapMode: Text.Wrap
+                        padding: 10
+                        topPadding: 10
+                        Component.onCompleted: {
+                            window.popupResultHeight = bodyPopUp.implicitHeight
+                        }
+                        onTextChanged: {
+                            window.popupResultHeight = bodyPopUp.implicitHeight
+                        }
+                    }
+                }
+            }
+        }
+
+        Rectangle {
+            id: popupButtonsRow
+            width: parent.width
+            height: 48
+            color: "transparent"
+            anchors.bottom: parent.bottom
+            RowLayout {
+                Layout.alignment: Qt.AlignHCenter | Qt.AlignBottom
+                width: parent.width
+                height: parent.height
+                spacing: 0
+
+                Repeater {
+                    model: window.popupButtons
+                    Button {
+                        text: modelData.text
+                        onClicked: {
+                            window.popupState = "closed"
+                            // modelData.onClicked(popupData)
+
+                            // jesus todo: I don't know why but I can't call functions passed inside the object.
+                            // printing the keys shows that the function is there, but calling it says it's undefined. ???
+
+                            if (modelData.text === "Open") {
+                                QRCodeHandler.openUrlInFirefox(window.popupData)
+                            } else if (modelData.text === "Connect") {
+                                QRCodeHandler.connectToWifi();
+                            } else if (modelData.text === "Show photo") {
+                                window.showMediaView(window.popupData)
+                            } else if (modelData.text === "Copy") {
+                                /* oh god */
+                                copyToClipboardHelper.selectAll()
+                                copyToClipboardHelper.copy()
+                            }
+                        }
+
+                        Layout.fillWidth: true
+                        Layout.fillHeight: true
+
+                        background: Rectangle {
+                            color: parent.down ? "#33ffffff" : "transparent"
+
+                            Behavior on color {
+                                ColorAnimation {
+                                    duration: 100
+                                }
+                            }
+                        }
+
+                        palette.buttonText: modelData.isPrimary ? "#62a0ea" : "white"
+                        font.pixelSize: 16
+                        font.bold: true
+
+                        clip: true
+                        Rectangle {
+                            visible: window.popupButtons.length > 1 && index < window.popupButtons.length - 1 ? 1 : 0
+                            border.width: 1
+                            border.color: "#565656"
+                            anchors.fill: parent
+                            anchors.leftMargin: -1
+                            anchors.topMargin: -1
+                            anchors.bottomMargin: -1
+                            color: "transparent"
+                        }
+                    }
+                }
+            }
+
+            /* top border */
+            clip: true
+            Rectangle {
+                border.width: 1
+                border.color: "#565656"
+                anchors.fill: parent
+                anchors.leftMargin: -2
+                anchors.rightMargin: -2
+                anchors.bottomMargin: -2
+                color: "transparent"
+            }
+        }
+    }
+    DropShadow {
+        anchors.fill: popup
+        horizontalOffset: 0
+        verticalOffset: 1
+        radius: 8
+        samples: 6
+        color: "#44000000"
+        source: popup
+    }
+}
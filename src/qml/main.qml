@@ -17,6 +17,7 @@ import QtQuick.Layouts 1.15
 import Qt.labs.settings 1.0
 import Qt.labs.platform 1.1
 import ZXing 1.0
+import FuriOS.Camera 1.0
 
 ApplicationWindow {
     id: window
@@ -37,7 +38,7 @@ ApplicationWindow {
     property bool videoCaptured: false
 
     property var countDown: 0
-    property var blurView: optionContainer.state == "closed" && infoDrawer.position == 0.0 ? 0 : 1
+    property var blurView: optionContainer.state == "closed" && (!infoDrawerLoader.item || infoDrawerLoader.item.position == 0.0) ? 0 : 1
     property var useFlash: 0
     property var frontCameras: 0
     property var backCameras: 0
@@ -50,12 +51,22 @@ ApplicationWindow {
     property var popupBody: null
     property var popupData: null
     property var popupButtons: null
-    property var mediaViewOpened: false
     property var focusPointVisible: false
     property var aeflock: "AEFLockOff"
 
+    // The drawers, the QR popup and the media review are not needed for the first frame,
+    // they load in the background once the camera is live
+    property bool deferredComponentsReady: false
+    readonly property var mediaView: mediaViewLoader.item
+    readonly property bool mediaViewVisible: mediaView ? mediaView.visible : false
+    readonly property int timerDelay: configBarLoader.item ? configBarLoader.item.currIndex : 0
+    readonly property bool timerMenuOpened: configBarLoader.item ? configBarLoader.item.opened === 1 : false
+    property bool pendingMediaView: false
+    property var pendingMediaViewCode: undefined
+    property int pendingTimerDelay: -1
 
-    property var gps_icon_source: settings.gpsOn ? "icons/gpsOn.svg" : "icons/gpsOff.svg"
+
+    property var gps_icon_source: settings.gpsOn ? "image://icons/gpsOn.svg" : "image://icons/gpsOff.svg"
     property var locationAvailable: 0
 
     signal customClosing()
@@ -82,6 +93,72 @@ ApplicationWindow {
         popupButtons = buttons
         popupData = data
         popupState = "opened"
+        deferredComponentsReady = true
+    }
+
+    function showMediaView(code) {
+        if (!mediaView) {
+            pendingMediaView = true
+            pendingMediaViewCode = code
+            deferredComponentsReady = true
+            return
+        }
+
+        mediaView.visible = true
+
+        if (code !== undefined) {
+            mediaView.showPhotoWithCode(code)
+        }
+    }
+
+    function openConfigBar() {
+        if (configBarLoader.item) {
+            configBarLoader.item.open()
+        }
+    }
+
+    function closeConfigBar() {
+        if (configBarLoader.item) {
+            configBarLoader.item.close()
+        }
+    }
+
+    function closeTimerMenu() {
+        if (configBarLoader.item) {
+            configBarLoader.item.opened = 0
+        }
+    }
+
+    function showTimerMenu(seconds) {
+        if (!configBarLoader.item) {
+            pendingTimerDelay = seconds
+            deferredComponentsReady = true
+            return
+        }
+
+        configBarLoader.item.setTimerDelay(seconds)
+        configBarLoader.item.opened = 1
+        configBarLoader.item.open()
+        optionContainer.state = "closed"
+        window.blurView = 1
+    }
+
+    // Launch intents handed over by SingleInstance: photo, video, scan and timer
+    function applyIntent(action, value) {
+        if (mediaView) {
+            mediaView.visible = false
+        }
+
+        if (action === "video") {
+            cslate.state = "VideoCapture"
+        } else if (action === "photo" || action === "scan" || action === "timer") {
+            // QR codes are only read in photo mode
+            cslate.state = "PhotoCapture"
+        }
+
+        if (action === "timer") {
+            showTimerMenu(value !== undefined ? value : 3)
+        }
     }
 
     Settings {
@@ -104,11 +181,19 @@ ApplicationWindow {
         property int soundOn: 1
         property var hideInfoDrawer: 0
         property int gpsOn: 0
+        // Seconds a remembered position may be used to tag photos before a fix arrives,
+        // and how long after the capture such a tag is still replaced by a live fix
+        property int gpsMaxFixAge: 900
+        property int gpsUpgradeWindow: 30
+        // Seconds the camera stays loaded after the window is hidden, 0 releases it at once
+        property int standbyTimeout: 60
+        property int inventoryMode: 0
+        property var inventoryExport: "json"
     }
 
     Settings {
         id: settingsCommon
-        fileName: fileManager.getConfigFile(); //"/etc/furios-camera.conf" or "/usr/lib/furios/device/furios-camera.conf"
+        fileName: FileManager.getConfigFile(); //"/etc/furios-camera.conf" or "/usr/lib/furios/device/furios-camera.conf"
 
         property var blacklist: 0
     }
@@ -255,7 +340,11 @@ ApplicationWindow {
         anchors.verticalCenterOffset: gcdValue === "16:9" ? -30 * window.scalingRatio : -60 * window.scalingRatio
         source: camera
         autoOrientation: true
-        filters: cslate.state === "PhotoCapture" ? [qrCodeComponent.qrcode] : []
+        filters: (cslate.state === "PhotoCapture" ? [qrCodeComponent.qrcode] : []).concat(firstFrameProbe.active ? [firstFrameProbe] : [])
+
+        FirstFrameProbe {
+            id: firstFrameProbe
+        }
 
         PinchArea {
             id: pinchArea
@@ -266,13 +355,13 @@ ApplicationWindow {
             pinch.target: camZoom
             pinch.maximumScale: camera.maximumDigitalZoom / camZoom.zoomFactor
             pinch.minimumScale: 0
-            enabled: !mediaView.visible && !window.videoCaptured
+            enabled: !window.mediaViewVisible && !window.videoCaptured
 
             MouseArea {
                 id: dragArea
                 hoverEnabled: true
                 anchors.fill: parent
-                enabled: !mediaView.visible && !window.videoCaptured
+                enabled: !window.mediaViewVisible && !window.videoCaptured
                 property real startX: 0
                 property real startY: 0
                 property int swipeThreshold: 80
@@ -298,7 +387,7 @@ ApplicationWindow {
                         lastTapTime = currentTime;
                         if (Math.abs(deltaY) > Math.abs(deltaX) && Math.abs(deltaY) > swipeThreshold) {
                             if (deltaY > 0) { // Swipe down logic
-                                configBarDrawer.open()
+                                window.openConfigBar()
                             } else { // Swipe up logic
                                 window.blurView = 1;
                                 flashButton.state = "flashOff"
@@ -352,9 +441,9 @@ ApplicationWindow {
                                 focusPointRect.y = mouse.y - (focusPointRect.height / 2)
                             }
 
-                            console.log("index: " + configBar.currIndex)
+                            console.log("index: " + window.timerDelay)
                             window.blurView = 0
-                            configBarDrawer.close()
+                            window.closeConfigBar()
                             optionContainer.state = "closed"
                             visTm.start()
                         }
@@ -512,18 +601,22 @@ ApplicationWindow {
                     sound.play()
                 }
 
-                if (settings.hideInfoDrawer == 0) {
-                    infoDrawer.open()
+                if (settings.hideInfoDrawer == 0 && infoDrawerLoader.item) {
+                    infoDrawerLoader.item.open()
                 }
 
-                if (mediaView.index < 0) {
+                if (mediaView && mediaView.index < 0) {
                     mediaView.folder = StandardPaths.writableLocation(StandardPaths.PicturesLocation) + "/furios-camera"
                 }
             }
 
             onImageSaved: {
-                if (window.locationAvailable === 1 ) {
-                    fileManager.appendGPSMetadata(path);
+                if (settings.gpsOn === 1) {
+                    FileManager.appendGPSMetadata(path);
+                }
+
+                if (settings.inventoryMode === 1) {
+                    InventoryScanner.scanImage(path, settings.inventoryExport);
                 }
             }
         }
@@ -550,6 +643,8 @@ ApplicationWindow {
             if (camera.cameraStatus == Camera.LoadedStatus) {
                 window.fnAspectRatio()
             } else if (camera.cameraStatus == Camera.ActiveStatus) {
+                StartupTimeline.mark("cameraActive")
+                window.deferredComponentsReady = true
                 camera.focus.focusMode = Camera.FocusContinuous
                 camera.focus.focusPointMode = Camera.FocusPointAuto
             }
@@ -717,7 +812,7 @@ ApplicationWindow {
                         property var numDigits: settings.cameras[model.cameraId].resolution.toString().length
                         Layout.alignment: Qt.AlignLeft
                         visible: parent.visible
-                        icon.source: "icons/cameraVideoSymbolic.svg"
+                        icon.source: "image://icons/cameraVideoSymbolic.svg"
                         icon.color: "white"
                         icon.width: 48
                         icon.height: 48
@@ -749,6 +844,17 @@ ApplicationWindow {
         }
     }
 
+    Timer {
+        id: deferredComponentsTimer
+        interval: 3000
+        running: !window.deferredComponentsReady
+
+        // Without a camera there is no ActiveStatus to wait for
+        onTriggered: {
+            window.deferredComponentsReady = true
+        }
+    }
+
     Timer {
         id: preCaptureTimer
         interval: 1000
@@ -764,80 +870,11 @@ ApplicationWindow {
         repeat: true
     }
 
-    Drawer {
-        id: infoDrawer
-        width: parent.width
-        edge: Qt.BottomEdge
-        dim: true
-        interactive: settings.hideInfoDrawer != 1
-
-        background: Rectangle {
-            anchors.fill: parent
-            color: "black"
-            opacity: 0.9
-        }
-
-        GridLayout {
-            columnSpacing: 5
-            rowSpacing: 25
-            anchors.centerIn: parent
-            width: parent.width * 0.9
-            columns: 2
-            rows: 2
-
-            Button {
-                icon.source: "icons/helpAboutSymbolic.svg"
-                icon.color: "lightblue"
-                icon.width: 48
-                icon.height: 48
-                Layout.preferredWidth: icon.width * 1.5
-                Layout.alignment: Qt.AlignHCenter | Qt.AlignTop
-                Layout.topMargin: 10
-
-                background: Rectangle {
-                    anchors.fill: parent
-                    color: "transparent"
-                }
-            }
-
-            Text {
-                Layout.alignment: Qt.AlignLeft
-                Layout.fillWidth: true
-                Layout.topMargin: 10
-                text: "Swipe down for more options"
-                horizontalAlignment: Text.AlignHCenter
-                color: "white"
-                font.pixelSize: 32
-                font.bold: true
-                style: Text.Outline;
-                styleColor: "black"
-                wrapMode: Text.WordWrap
-            }
-
-            Button {
-                icon.source: "icons/emblemDefaultSymbolic.svg"
-                icon.color: "white"
-                icon.width: 48
-                icon.height: 48
-                Layout.columnSpan: 2
-                Layout.alignment: Qt.AlignHCenter
-                Layout.fillWidth: true
-
-                background: Rectangle {
-                    anchors.fill: parent
-                    color: "transparent"
-                }
-
-                onClicked: {
-                    infoDrawer.close()
-                    settings.hideInfoDrawer = 1
-                    settings.setValue("hideInfoDrawer", 1);
-                }
-            }
-        }
-        onClosed: {
-            window.blurView = 0;
-        }
+    Loader {
+        id: infoDrawerLoader
+        asynchronous: true
+        active: window.deferredComponentsReady
+        source: "InfoDrawer.qml"
     }
 
     Item {
@@ -846,7 +883,7 @@ ApplicationWindow {
         anchors.bottomMargin: 43 * window.scalingRatio
         height: 150 * window.scalingRatio
         width: parent.width
-        visible: !mediaView.visible
+        visible: !window.mediaViewVisible
 
         Item {
             id: hotBar
@@ -871,7 +908,7 @@ ApplicationWindow {
 
                     height: width
                     anchors.fill: parent
-                    icon.source: flashButton.state === "flashOn" ? "icons/flashOn.svg" : flashButton.state === "flashOff" ? "icons/flashOff.svg" : "icons/flashAuto.svg"
+                    icon.source: flashButton.state === "flashOn" ? "image://icons/flashOn.svg" : flashButton.state === "flashOff" ? "image://icons/flashOff.svg" : "image://icons/flashAuto.svg"
                     icon.height: parent.height / 1.5
                     icon.width: parent.height / 1.5
                     icon.color: "white"
@@ -970,7 +1007,7 @@ ApplicationWindow {
                             Layout.fillWidth: true
                             Layout.fillHeight: true
 
-                            icon.source: "icons/cameraState.svg"
+                            icon.source: "image://icons/cameraState.svg"
                             icon.height: parent.height * 0.5
                             icon.width: parent.height * 0.5 * 1.067
                             icon.color: "white"
@@ -1000,7 +1037,7 @@ ApplicationWindow {
                             Layout.fillWidth: true
                             Layout.fillHeight: true
 
-                            icon.source: "icons/videoState.svg"
+                            icon.source: "image://icons/videoState.svg"
                             icon.height: parent.height * 0.5
                             icon.width: parent.height * 0.5
                             icon.color: "white"
@@ -1044,7 +1081,7 @@ ApplicationWindow {
 
                     height: width
                     anchors.fill: parent
-                    icon.source: window.aeflock === "AEFLockOn" ? "icons/AEFLockOn.svg" : "icons/AEFLockOff.svg"
+                    icon.source: window.aeflock === "AEFLockOn" ? "image://icons/AEFLockOn.svg" : "image://icons/AEFLockOff.svg"
                     icon.height: parent.height / 1.5
                     icon.width: parent.height / 1.5
                     icon.color: "white"
@@ -1145,7 +1182,7 @@ ApplicationWindow {
                 Button {
                     id: rotateCamera
                     anchors.fill: parent
-                    icon.source: "icons/rotateCamera.svg"
+                    icon.source: "image://icons/rotateCamera.svg"
                     icon.color: "white"
                     icon.width: rotateBtnFrame.height * 0.45
                     icon.height: rotateBtnFrame.height * 0.3
@@ -1204,7 +1241,7 @@ ApplicationWindow {
                         transformOrigin: Item.Center
                         fillMode: Image.Stretch
                         smooth: false
-                        source: (cslate.state == "PhotoCapture") ? mediaView.lastImg : ""
+                        source: (cslate.state == "PhotoCapture" && mediaView) ? mediaView.lastImg : ""
                         scale: Math.min(parent.width / width, parent.height / height)
                     }
                 }
@@ -1217,7 +1254,7 @@ ApplicationWindow {
                     MouseArea {
                         anchors.fill: parent
                         onClicked: {
-                            mediaView.visible = true;
+                            window.showMediaView();
                         }
                     }
                 }
@@ -1246,7 +1283,7 @@ ApplicationWindow {
                             id: shutterBtnLoader
                             anchors.fill: parent
                             asynchronous: true
-                            sourceComponent: configBar.opened === 1 || preCaptureTimer.running ? timerShutter : pictureShutter
+                            sourceComponent: window.timerMenuOpened || preCaptureTimer.running ? timerShutter : pictureShutter
                         }
 
                         Component{
@@ -1265,7 +1302,7 @@ ApplicationWindow {
                                     anchors.centerIn: parent
                                     height: shutterBtnFrame.height
                                     width: height
-                                    enabled: cslate.state === "PhotoCapture" && !mediaView.visible
+                                    enabled: cslate.state === "PhotoCapture" && !window.mediaViewVisible
 
                                     background: Rectangle {
                                         id: camerabtn
@@ -1314,8 +1351,8 @@ ApplicationWindow {
                                     id: shutterBtn
                                     anchors.fill: parent.fill
                                     anchors.centerIn: parent
-                                    enabled: cslate.state === "PhotoCapture" && !mediaView.visible
-                                    icon.source: preCaptureTimer.running ? "" : configBar.currIndex === 0 ? "icons/windowCloseSymbolic.svg" : "icons/timer.svg"
+                                    enabled: cslate.state === "PhotoCapture" && !window.mediaViewVisible
+                                    icon.source: preCaptureTimer.running ? "" : window.timerDelay === 0 ? "image://icons/windowCloseSymbolic.svg" : "image://icons/timer.svg"
                                     icon.color: "white"
                                     icon.width: shutterBtnFrame.width - 10
                                     icon.height: shutterBtnFrame.height - 10
@@ -1341,14 +1378,14 @@ ApplicationWindow {
                                         pinchArea.enabled = true
                                         window.blurView = 0
 
-                                        if (configBar.currIndex > 0) {
-                                            configBar.opened = 0
+                                        if (window.timerDelay > 0) {
+                                            countDown = window.timerDelay
+                                            window.closeTimerMenu()
                                             optionContainer.state = "closed"
-                                            countDown = configBar.currIndex
                                             preCaptureTimer.start()
-                                        } else if (configBar.currIndex < 1) {
+                                        } else if (window.timerDelay < 1) {
                                             optionContainer.state = "closed"
-                                            configBar.opened = 0
+                                            window.closeTimerMenu()
                                         }
                                     }
                                 }
@@ -1374,7 +1411,7 @@ ApplicationWindow {
                         Button {
                             id: videoBtn
                             anchors.fill: parent
-                            enabled: !mediaView.visible
+                            enabled: !window.mediaViewVisible
 
                             Rectangle {
                                 id: redCircle
@@ -1492,538 +1529,102 @@ ApplicationWindow {
         }
     }
 
-    MediaReview {
-        id: mediaView
+    Loader {
+        id: mediaViewLoader
         anchors.fill: parent
-        onClosed: camera.start()
-        focus: visible
-
-        scalingRatio: window.scalingRatio
-    }
-    
-    Rectangle {
-        id: popupBackdrop
-        width: window.width
-        height: window.height
-        color: "#66000000"
-        opacity: popupState === "opened" ? 1 : 0
-        visible: popupState === "opened"
-
-        Behavior on opacity {
-            NumberAnimation {
-                duration: 125
-            }
-        }
-
-        Behavior on visible {
-            PropertyAnimation {
-                duration: 125
-            }
+        asynchronous: true
+        active: window.deferredComponentsReady
+        focus: window.mediaViewVisible
+        sourceComponent: MediaReview {
+            onClosed: camera.start()
+            focus: visible
+
+            scalingRatio: window.scalingRatio
         }
 
-        MouseArea {
-            anchors.fill: parent
-            onClicked: {
-                popupState = "closed"
+        onLoaded: {
+            if (window.pendingMediaView) {
+                window.pendingMediaView = false
+                window.showMediaView(window.pendingMediaViewCode)
             }
         }
+    }
+    
+    Connections {
+        target: FileManager
 
-        TextEdit {
-            id: copyToClipboardHelper
-            opacity: 0
-            text: popupData
+        function onGpsDataReady() {
+            window.gps_icon_source = "image://icons/gpsOn.svg";
+            window.locationAvailable = 1;
         }
+    }
 
-        Rectangle {
-            id: popup
-            width: window.width * 0.8
-            height: window.popupResultHeight + titlePopUp.implicitHeight + popupButtonsRow.height
-            color: "#ff383838"
-            radius: 10
-            anchors.centerIn: parent
-
-            /* adwaita-like popup: big title, center-aligned text, buttons at the bottom */
-            Column {
-                anchors.horizontalCenter: parent.horizontalCenter
-                width: parent.width
-                spacing: 0
-
-                Text {
-                    id: titlePopUp
-                    text: popupTitle
-                    color: "white"
-                    font.pixelSize: 24
-                    font.weight: Font.ExtraBold
-                    horizontalAlignment: Text.AlignHCenter
-                    width: parent.width
-                    wrapMode: Text.WordWrap
-                    topPadding: 20
-                }
-
-                Loader {
-                    id: popupBodyLoader
-                    width: parent.width
-                    height: window.popupResultHeight
-                    asynchronous: true
-                    sourceComponent: popupTitle === "Connect to Network?" ? wifiComponent : qrTextComponent
-                }
-
-                Component {
-                    id: wifiComponent
-                    Item {
-                        id: wifiItem
-
-                        property var currentSignalIcon: "icons/network-wireless-signal-offline.svg"
-                        property var isFirstPopup: false
-
-                        RowLayout {
-                            anchors.horizontalCenter: parent.horizontalCenter
-
-                            Timer {
-                                id: signalStrengthIconTimer
-                                interval: 3000
-                                repeat: true
-                                running: wifiItem.visible
-                                onTriggered: {
-                                    currentSignalIcon = QRCodeHandler.getSignalStrengthIcon()
-
-                                    if (isFirstPopup == false){
-                                       isFirstPopup = true;
-                                    }
-                                }
-                            }
-
-                            Text {
-                                id: wifiBodyPopUp
-                                text: popupBody
-                                color: "white"
-                                font.pixelSize: 16
-                                horizontalAlignment: Text.AlignHCenter
-                                Layout.alignment: Qt.AlignVCenter
-                                width: parent.width
-                                wrapMode: Text.Wrap
-                                padding: 10
-                                topPadding: 10
-                                bottomPadding: 25
-                            }
-
-                            Button {
-                                id: wifiButton
-                                icon.source: isFirstPopup ? currentSignalIcon : QRCodeHandler.getSignalStrengthIcon()
-                                icon.color: "white"
-                                padding: 10
-                                topPadding: 10
-                                bottomPadding: 25
-                                width: 30 * window.scalingRatio
-                                height: 30 * window.scalingRatio
-                                flat: true
-
-                                Component.onCompleted: {
-                                    window.popupResultHeight = 40
-                                }
-                            }
-                        }
-                    }
-                }
-
-                Component {
-                    id: qrTextComponent
-                    Item {
-                        id: qrTextItem
-
-                        Text {
-                            id: bodyPopUp
-                            text: popupBody
-                            color: "white"
-                            font.pixelSize: 16
-                            horizontalAlignment: Text.AlignHCenter
-                            Layout.alignment: Qt.AlignVCenter
-                            width: parent.width
-                            wrapMode: Text.Wrap
-                            padding: 10
-                            topPadding: 10
-                            Component.onCompleted: {
-                                window.popupResultHeight = bodyPopUp.implicitHeight
-                            }
-                            onTextChanged: {
-                                window.popupResultHeight = bodyPopUp.implicitHeight
-                            }
-                        }
-                    }
-                }
-            }
-
-            Rectangle {
-                id: popupButtonsRow
-                width: parent.width
-                height: 48
-                color: "transparent"
-                anchors.bottom: parent.bottom
-                RowLayout {
-                    Layout.alignment: Qt.AlignHCenter | Qt.AlignBottom
-                    width: parent.width
-                    height: parent.height
-                    spacing: 0
-
-                    Repeater {
-                        model: popupButtons
-                        Button {
-                            text: modelData.text
-                            onClicked: {
-                                popupState = "closed"
-                                // modelData.onClicked(popupData)
-
-                                // jesus todo: I don't know why but I can't call functions passed inside the object.
-                                // printing the keys shows that the function is there, but calling it says it's undefined. ???
-
-                                if (modelData.text === "Open") {
-                                    QRCodeHandler.openUrlInFirefox(popupData)
-                                } else if (modelData.text === "Connect") {
-                                    QRCodeHandler.connectToWifi();
-                                } else if (modelData.text === "Copy") {
-                                    /* oh god */
-                                    copyToClipboardHelper.selectAll()
-                                    copyToClipboardHelper.copy()
-                                }
-                            }
-
-                            Layout.fillWidth: true
-                            Layout.fillHeight: true
-
-                            background: Rectangle {
-                                color: parent.down ? "#33ffffff" : "transparent"
-
-                                Behavior on color {
-                                    ColorAnimation {
-                                        duration: 100
-                                    }
-                                }
-                            }
-
-                            palette.buttonText: modelData.isPrimary ? "#62a0ea" : "white"
-                            font.pixelSize: 16
-                            font.bold: true
-
-                            clip: true
-                            Rectangle {
-                                visible: popupButtons.length > 1 && index < popupButtons.length - 1 ? 1 : 0
-                                border.width: 1
-                                border.color: "#565656"
-                                anchors.fill: parent
-                                anchors.leftMargin: -1
-                                anchors.topMargin: -1
-                                anchors.bottomMargin: -1
-                                color: "transparent"
-                            }
-                        }
-                    }
-                }
+    Connections {
+        // Naming the singleton builds it, which waits for the first frame like the
+        // other deferred components
+        target: window.deferredComponentsReady ? InventoryScanner : null
 
-                /* top border */
-                clip: true
-                Rectangle {
-                    border.width: 1
-                    border.color: "#565656"
-                    anchors.fill: parent
-                    anchors.leftMargin: -2
-                    anchors.rightMargin: -2
-                    anchors.bottomMargin: -2
-                    color: "transparent"
+        function onScanFinished(imagePath, count, exportPath) {
+            openPopup("Inventory", count + " codes found" + (exportPath !== "" ? "\n" + exportPath : ""), [
+                {
+                    text: "OK",
+                    isPrimary: true,
                 }
-            }
-        }
-        DropShadow {
-            anchors.fill: popup
-            horizontalOffset: 0
-            verticalOffset: 1
-            radius: 8
-            samples: 6
-            color: "#44000000"
-            source: popup
+            ], exportPath)
         }
     }
 
-    Drawer {
-        id: configBarDrawer
-        height: 55 * window.scalingRatio
-        width: window.width
-        dim: false
-        edge: Qt.TopEdge
-        modal: false
-        interactive: false
-
-        visible: !configBarBtn.visible
-
-        background: Rectangle {
-            anchors.fill: parent
-            color: "transparent"
-        }
-
-        Item {
-            id: configBar
-            width: parent.width
-            height: configBarDrawer.height
-            anchors.horizontalCenter: parent.horizontalCenter
-            anchors.verticalCenter: parent.verticalCenter
-            anchors.verticalCenterOffset: 20 * window.scalingRatio
-
-            property var opened: 0;
-            property var aspectRatioOpened: 0;
-            property var currIndex: timerTumbler.currentIndex
-            visible: !mediaView.visible && !window.videoCaptured
-
-            RowLayout {
-                anchors.horizontalCenter: parent.horizontalCenter
-                spacing: configBarDrawer.height * 0.8
-
-                Button {
-                    icon.source: settings.soundOn === 1 ? "icons/audioOn.svg" : "icons/audioOff.svg"
-                    icon.height: configBarDrawer.height * 0.6
-                    icon.width: configBarDrawer.height * 0.6
-                    icon.color: settings.soundOn === 1 ? "white" : "grey"
-
-                    background: Rectangle {
-                        anchors.fill: parent
-                        color: "transparent"
-                    }
-
-                    onClicked: {
-                        settings.soundOn = settings.soundOn === 1 ? 0 : 1;
-                    }
-                }
-
-                Button {
-                    icon.source: window.gps_icon_source
-                    icon.height: configBarDrawer.height * 0.6
-                    icon.width: configBarDrawer.height * 0.6
-                    icon.color: window.locationAvailable === 1 ? "white" : "grey"
-
-                    background: Rectangle {
-                        anchors.fill: parent
-                        color: "transparent"
-                    }
-
-                    Connections {
-                        target: fileManager
-
-                        function onGpsDataReady() {
-                            window.gps_icon_source = "icons/gpsOn.svg";
-                            window.locationAvailable = 1;
-                        }
-                    }
-
-                    onClicked: {
-                        settings.gpsOn = settings.gpsOn === 1 ? 0 : 1;
-
-                        if (settings.gpsOn === 1) {
-                            fileManager.turnOnGps();
-                        } else {
-                            fileManager.turnOffGps();
-                            window.gps_icon_source = "icons/gpsOff.svg";
-                            window.locationAvailable = 0;
-                        }
-                    }
-
-                    Connections {
-                        target: fileManager
+    Connections {
+        target: window.deferredComponentsReady ? QRCodeHandler : null
 
-                        function onGpsDataReady() {
-                            window.gps_icon_source = "icons/gpsOn.svg";
-                            window.locationAvailable = 1;
-                        }
-                    }
-                }
-
-                Button {
-                    id: timerButton
-                    icon.source: "icons/timer.svg"
-                    icon.height: configBarDrawer.height * 0.6
-                    icon.width: configBarDrawer.height * 0.6
-                    icon.color: "white"
-
-                    background: Rectangle {
-                        anchors.fill: parent
-                        color: "transparent"
-                    }
-
-                    onClicked: {
-                        configBar.opened = configBar.opened === 1 ? 0 : 1
-                        configBar.aspectRatioOpened = 0
-                        optionContainer.state = "closed"
-                        window.blurView = 1
-                    }
-
-                    Tumbler {
-                        id: timerTumbler
-                        height: 200 * window.scalingRatio
-                        width: 50 * window.scalingRatio
-                        anchors.horizontalCenter: timerButton.horizontalCenter
-                        Layout.preferredWidth: parent.width
-                        anchors.top: timerButton.bottom
-                        model: 60
-                        visible: configBar.opened === 1 ? true : false
-                        enabled: configBar.opened === 1 ? true : false
-
-                        delegate: Text {
-                            text: modelData == 0 ? "Off" : modelData
-                            color: "white"
-                            font.bold: true
-                            font.pixelSize: 30 * window.scalingRatio
-                            font.family: "Lato Hairline"
-                            horizontalAlignment: Text.AlignHCenter
-                            opacity: 0.4 + Math.max(0, 1 - Math.abs(Tumbler.displacement)) * 0.6
-                        }
-
-                        Behavior on opacity {
-                            NumberAnimation {
-                                duration: 300
-                                easing.type: Easing.InOutQuad
-                            }
-                        }
-
-                        onVisibleChanged: {
-                            opacity = visible ? 1 : 0
-                        }
-                    }
-                }
-
-                Button {
-                    id: aspectRatioButton
-                    icon.source: "icons/aspectRatioMenu.svg"
-                    icon.height: configBarDrawer.height * 0.6
-                    icon.width: configBarDrawer.height * 0.6
-                    icon.color: "white"
-
-                    background: Rectangle {
-                        anchors.fill: parent
-                        color: "transparent"
-                    }
-
-                    onClicked: {
-                        configBar.aspectRatioOpened = configBar.aspectRatioOpened === 1 ? 0 : 1
-                        optionContainer.state = "closed"
-                        configBar.opened = 0
-                    }
-
-                    ColumnLayout {
-                        id: aspectRatios
-                        anchors.top: aspectRatioButton.bottom
-                        anchors.horizontalCenter: aspectRatioButton.horizontalCenter
-                        visible: configBar.aspectRatioOpened === 1 ? true : false
-                        spacing: 5 * window.scalingRatio
-
-                        Button {
-                            id: sixteenNineButton
-                            text: "16:9"
-                            Layout.preferredWidth: 60 * window.scalingRatio
-                            font.pixelSize:  35 * window.scalingRatio * 0.5
-                            font.bold: true
-                            font.family: "Lato Hairline"
-                            palette.buttonText: camera.aspWide === 1 ? "white" : "gray"
-
-                            background: Rectangle {
-                                width: 60 * window.scalingRatio
-                                height: 35 * window.scalingRatio
-                                anchors.centerIn: parent
-                                color: "transparent"
-                                border.width: 1 * window.scalingRatio
-                                border.color: "white"
-                                radius: 6 * window.scalingRatio
-                            }
-
-                            onClicked: {
-                                camera.aspWide = 1;
-                                configBar.aspectRatioOpened = 0;
-                                camera.imageCapture.resolution = camera.firstSixteenNineResolution
-                            }
-                        }
-
-                        Button {
-                            id: fourThreeButton
-                            text: "4:3"
-                            Layout.preferredWidth: 60 * window.scalingRatio
-                            font.pixelSize:  35 * window.scalingRatio * 0.5
-                            font.bold: true
-                            font.family: "Lato Hairline"
-                            palette.buttonText: camera.aspWide === 1 ? "gray" : "white"
-
-                            background: Rectangle {
-                                width: 60 * window.scalingRatio
-                                height: 35 * window.scalingRatio
-                                anchors.centerIn: parent
-                                color: "transparent"
-                                border.width: 1 * window.scalingRatio
-                                border.color: "white"
-                                radius: 6 * window.scalingRatio
-                            }
-
-                            onClicked: {
-                                camera.aspWide = 0;
-                                configBar.aspectRatioOpened = 0;
-                                camera.imageCapture.resolution = camera.firstFourThreeResolution
-                            }
-                        }
-
-                        Behavior on opacity {
-                            NumberAnimation {
-                                duration: 300
-                                easing.type: Easing.InOutQuad
-                            }
-                        }
-
-                        onVisibleChanged: {
-                            opacity = visible ? 1 : 0
-                        }
-                    }
+        function onJoinFailed(ssid, reason) {
+            openPopup("Couldn't connect to " + ssid, reason, [
+                {
+                    text: "OK",
+                    isPrimary: true,
                 }
+            ], reason)
+        }
+    }
 
-                Button {
-                    id: menu
-                    icon.source: "icons/menu.svg"
-                    icon.height: configBarDrawer.height * 0.6
-                    icon.width: configBarDrawer.height * 0.6
-                    icon.color: "white"
-                    enabled: !window.videoCaptured
+    Loader {
+        id: qrPopupLoader
+        asynchronous: true
+        active: window.deferredComponentsReady
+        source: "QrPopup.qml"
+    }
 
-                    background: Rectangle {
-                        anchors.fill: parent
-                        color: "transparent"
-                    }
+    Loader {
+        id: configBarLoader
+        asynchronous: true
+        active: window.deferredComponentsReady
+        source: "ConfigBarDrawer.qml"
 
-                    onClicked: {
-                        backCamSelect.visible = true
-                        optionContainer.state = "opened"
-                        configBarDrawer.close()
-                        window.blurView = 1
-                    }
-                }
+        onLoaded: {
+            if (window.pendingTimerDelay >= 0) {
+                window.showTimerMenu(window.pendingTimerDelay)
+                window.pendingTimerDelay = -1
             }
         }
-
-        onClosed: {
-            window.blurView = optionContainer.state === "opened" ? 1 : 0;
-            configBar.opened = 0;
-            configBar.aspectRatioOpened = 0;
-        }
     }
 
     Button {
         id: configBarBtn
-        icon.source: configBarDrawer.position == 0.0 ?  "icons/goDownSymbolic.svg" : ""
-        icon.height: configBarDrawer.height * 0.5
-        icon.width: configBarDrawer.height * 0.7
+        icon.source: !configBarLoader.item || configBarLoader.item.position == 0.0 ?  "image://icons/goDownSymbolic.svg" : ""
+        icon.height: 55 * window.scalingRatio * 0.5
+        icon.width: 55 * window.scalingRatio * 0.7
         icon.color: "white"
 
         anchors.horizontalCenter: parent.horizontalCenter
         anchors.top: parent.top
         anchors.topMargin: 10 * window.scalingRatio
 
-        visible: !mediaView.visible
+        visible: !window.mediaViewVisible
         flat: true
         down: false
 
         onClicked: {
-            configBarDrawer.open()
+            window.openConfigBar()
         }
     }
 }
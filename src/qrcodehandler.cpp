@@ -6,543 +6,387 @@
 // Joaquin Philco <joaquinphilco@gmail.com>
 
 #include "qrcodehandler.h"
+#include "qrpayload.h"
+#include "networkmanagerclient.h"
+#include "wifisignalmonitor.h"
+#include "wificonnectionindex.h"
 #include <QProcess>
-#include <cstdlib>
-#include <iostream>
-#include <QRegularExpression>
 #include <QUrl>
 #include <QDebug>
 #include <QtDBus>
 #include <QDBusConnection>
 #include <QDBusMessage>
-
-QRegularExpression urlPattern("^(?:http(s)?://)?[\\w.-]+(?:\\.[\\w.-]+)+[\\w\\-._~:/?#[\\]@!$&'()*+,;=]*$");
-QRegularExpression wifiPattern("^WIFI:S:([^;]+);T:([^;]+);P:([^;]+)");
-
-QRCodeHandler::QRCodeHandler(QObject *parent) : QObject(parent) {
-    const char* waylandDisplay = getenv("WAYLAND_DISPLAY");
-
-    if (waylandDisplay == nullptr) {
-        setenv("WAYLAND_DISPLAY", "wayland-0", 1);
-        std::cout << "WAYLAND_DISPLAY was not set. It is now set to 'wayland-0'." << std::endl;
-    } else {
-        std::cout << "WAYLAND_DISPLAY is already set to '" << waylandDisplay << "'." << std::endl;
-    }
+#include <QDBusPendingCallWatcher>
+
+#define NM_SERVICE "org.freedesktop.NetworkManager"
+#define NM_PATH "/org/freedesktop/NetworkManager"
+#define NM_SETTINGS_PATH "/org/freedesktop/NetworkManager/Settings"
+#define NM_SETTINGS_CONNECTION_INTERFACE "org.freedesktop.NetworkManager.Settings.Connection"
+#define NM_ACTIVE_CONNECTION_INTERFACE "org.freedesktop.NetworkManager.Connection.Active"
+// Association plus DHCP on a slow access point
+#define JOIN_TIMEOUT 30000
+
+QRCodeHandler::QRCodeHandler(QObject *parent) : QObject(parent), networkManager(new NetworkManagerClient(this)) {
+    signalMonitor = new WifiSignalMonitor(networkManager, this);
+    connectionIndex = new WifiConnectionIndex(this);
+    connect(signalMonitor, &WifiSignalMonitor::signalChanged, this, &QRCodeHandler::signalChanged);
+
+    joinTimer.setSingleShot(true);
+    joinTimer.setInterval(JOIN_TIMEOUT);
+    connect(&joinTimer, &QTimer::timeout, this, &QRCodeHandler::onJoinTimeout);
 }
 
 QString QRCodeHandler::parseQrString(const QString &qrString) {
-    QString mutableQrString = qrString;
-
-    if (urlPattern.match(mutableQrString).hasMatch()) {
-        return QString("URL");
-    } else if (wifiPattern.match(mutableQrString).hasMatch()) {
-        QString mutableCredentials = qrString;
-
-        QRegularExpressionMatch match = wifiPattern.match(mutableCredentials);
-        ssid = match.captured(1);
-        protocol = match.captured(2);
-        password = match.captured(3);
-
-        return QString("WIFI");
-    } else {
+    QrPayload payload = parseQrPayload(qrString);
+
+    switch (payload.type) {
+    case QrPayload::Wifi:
+        ssid = payload.ssid;
+        protocol = payload.security;
+        password = payload.password;
+        hidden = payload.hidden;
+        signalMonitor->setSsid(ssid);
+        break;
+    case QrPayload::MeCard:
+    case QrPayload::VCard:
+        contactSummary.clear();
+        for (const QString &field : {payload.name, payload.phone, payload.email}) {
+            if (!field.isEmpty()) {
+                contactSummary += (contactSummary.isEmpty() ? "" : "\n") + field;
+            }
+        }
+        break;
+    case QrPayload::Unknown:
         qDebug() << "Invalid QR string: " << qrString;
+        break;
+    default:
+        break;
     }
-    return QString("");
+
+    return payload.typeName();
 }
 
 void QRCodeHandler::openUrlInFirefox(const QString &url) {
     QString mutableUrl = url;
 
-    if (!mutableUrl.startsWith("http://") && !mutableUrl.startsWith("https://")) {
+    // geo:, tel: and mailto: are handed to xdg-open as they are
+    if (parseQrPayload(mutableUrl).type == QrPayload::Url &&
+        !mutableUrl.startsWith("http://", Qt::CaseInsensitive) && !mutableUrl.startsWith("https://", Qt::CaseInsensitive)) {
         mutableUrl.prepend("http://");
     }
-    QProcess::startDetached("xdg-open", QStringList() << mutableUrl);
-}
 
-void QRCodeHandler::connectToWifi() {
-    QDBusInterface wifiEnabled("org.freedesktop.NetworkManager",
-                               "/org/freedesktop/NetworkManager",
-                               "org.freedesktop.DBus.Properties",
-                               QDBusConnection::systemBus());
-
-    if (!wifiEnabled.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        return;
+    // The browser needs a Wayland display even when we were started without one,
+    // only its environment is changed, not ours
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    if (!environment.contains("WAYLAND_DISPLAY")) {
+        environment.insert("WAYLAND_DISPLAY", "wayland-0");
     }
 
+    QProcess process;
+    process.setProgram("xdg-open");
+    process.setArguments(QStringList() << mutableUrl);
+    process.setProcessEnvironment(environment);
+    process.startDetached();
+}
+
+void QRCodeHandler::connectToWifi() {
     qDBusRegisterMetaType<Connection>();
 
-    Connection connection;
+    // A new request replaces whatever join was still in flight
+    finishJoin();
+    joinTimer.start();
+    joinDevice.clear();
+    joinActiveConnection.clear();
 
-    if (!QRCodeHandler::deactivateConnection()) {
-        qWarning() << "Failed to deactivate connection";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
+    if (networkManager->wirelessEnabled()) {
+        forgetConnections();
         return;
     }
 
-    if (!QRCodeHandler::forgetConnection()) {
-        qWarning() << "Failed to forget connection";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return;
-    }
+    setJoinState("enabling");
 
     // Enable WiFi by setting WirelessEnabled to true (RF kill switch)
-    QDBusReply<void> reply = wifiEnabled.call("Set", "org.freedesktop.NetworkManager", "WirelessEnabled", QVariant::fromValue(QDBusVariant(QVariant(true))));
+    QDBusMessage enable = QDBusMessage::createMethodCall(NM_SERVICE, NM_PATH, "org.freedesktop.DBus.Properties", "Set");
+    enable << NM_SERVICE << "WirelessEnabled" << QVariant::fromValue(QDBusVariant(QVariant(true)));
 
-    if (!reply.isValid()) {
-        qWarning() << "Failed to turn on wifi: " << reply.error().name() + " : " + reply.error().message();
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return;
-    } else {
+    asyncCall(enable, [this](const QDBusMessage &) {
         qDebug() << "Successfully turned on wifi";
-    }
+        forgetConnections();
+    });
+}
 
-    connection["connection"]["type"] = "802-11-wireless";
-    connection["connection"]["uuid"] = QUuid::createUuid().toString().remove('{').remove('}');
-    connection["connection"]["id"] = ssid;
-    connection["connection"]["autoconnect-retries"] = -1;
+void QRCodeHandler::forgetConnections() {
+    setJoinState("forgetting");
 
-    connection["802-11-wireless"]["ssid"] = ssid.toUtf8();
-    connection["802-11-wireless"]["hidden"] = false;
-    connection["802-11-wireless"]["mode"] = "infrastructure";
+    // Profiles for the same SSID would be picked over the one we add, so they go first
+    if (connectionIndex->isReady()) {
+        const QStringList paths = connectionIndex->connections(ssid);
+        pendingJoinCalls = paths.size();
 
-    if (!password.isEmpty()) {
-        connection["802-11-wireless-security"]["key-mgmt"] = "wpa-psk";
-        connection["802-11-wireless-security"]["auth-alg"] = "open";
-        connection["802-11-wireless-security"]["psk"] = password;
-    } else {
-        connection["802-11-wireless-security"]["key-mgmt"] = "none";
+        if (pendingJoinCalls == 0) {
+            findWiFiDevice();
+            return;
+        }
+
+        for (const QString &path : paths) {
+            deleteConnection(path);
+        }
+        return;
     }
 
-    connection["ipv4"]["method"] = "auto";
-    connection["ipv4"]["dns-priority"] = 600;
-    connection["ipv6"]["method"] = "ignore";
+    // The index is still being built, look through every profile instead
+    QDBusMessage list = QDBusMessage::createMethodCall(NM_SERVICE, NM_SETTINGS_PATH, "org.freedesktop.NetworkManager.Settings", "ListConnections");
 
-    QDBusInterface nmSettings("org.freedesktop.NetworkManager",
-                              "/org/freedesktop/NetworkManager/Settings",
-                              "org.freedesktop.NetworkManager.Settings",
-                              QDBusConnection::systemBus());
+    asyncCall(list, [this](const QDBusMessage &reply) {
+        const QList<QDBusObjectPath> paths = qdbus_cast<QList<QDBusObjectPath>>(reply.arguments().value(0));
+        pendingJoinCalls = paths.size();
 
-    if (!nmSettings.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return;
-    }
+        if (pendingJoinCalls == 0) {
+            findWiFiDevice();
+            return;
+        }
 
-    // Add the connection
-    QDBusReply<QDBusObjectPath> result = nmSettings.call("AddConnection", QVariant::fromValue(connection));
+        for (const QDBusObjectPath &path : paths) {
+            QDBusMessage get = QDBusMessage::createMethodCall(NM_SERVICE, path.path(), NM_SETTINGS_CONNECTION_INTERFACE, "GetSettings");
 
-    if (!result.isValid()) {
-       qWarning() << "Error adding connection: " << result.error().name() << " : " << result.error().message();
-    } else {
-       qDebug() << "Added: " << result.value().path();
-       qDebug() << "Connection added successfully";
-    }
+            asyncCall(get, [this, path](const QDBusMessage &reply) {
+                const Connection settings = qdbus_cast<Connection>(reply.arguments().value(0));
 
-    accessPointAddedCalled = 0;
-    QList<QString> devices = QRCodeHandler::getWiFiDevices();
-
-    if (!devices.isEmpty()) {
-        WiFiDevice = devices.at(0);
-        QDBusConnection::systemBus().connect(
-            "org.freedesktop.NetworkManager",
-            WiFiDevice,
-            "org.freedesktop.NetworkManager.Device.Wireless",
-            "AccessPointAdded",
-            this,
-            SLOT(onAccessPointAdded(QDBusMessage))
-        );
-    }
+                if (settings["connection"]["type"].toString() == "802-11-wireless" &&
+                    QString::fromUtf8(settings["802-11-wireless"]["ssid"].toByteArray()) == ssid) {
+                    deleteConnection(path.path());
+                    return;
+                }
 
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
+                forgetConnectionDone();
+            }, [this, path](const QDBusMessage &) {
+                qWarning() << "Failed to get settings for connection:" << path.path();
+                forgetConnectionDone();
+            });
+        }
+    });
 }
 
-bool QRCodeHandler::forgetConnection() {
-    qDBusRegisterMetaType<Connection>;
+void QRCodeHandler::deleteConnection(const QString &path) {
+    QDBusMessage remove = QDBusMessage::createMethodCall(NM_SERVICE, path, NM_SETTINGS_CONNECTION_INTERFACE, "Delete");
 
-    QDBusInterface nmSettings("org.freedesktop.NetworkManager",
-                              "/org/freedesktop/NetworkManager/Settings",
-                              "org.freedesktop.NetworkManager.Settings",
-                              QDBusConnection::systemBus());
+    asyncCall(remove, [this](const QDBusMessage &) {
+        qDebug() << "Successfully deleted connection with SSID:" << ssid;
+        forgetConnectionDone();
+    }, [this, path](const QDBusMessage &error) {
+        qWarning() << "Failed to delete connection:" << path << error.errorMessage();
+        forgetConnectionDone();
+    });
+}
 
-    if (!nmSettings.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        return false;
+void QRCodeHandler::forgetConnectionDone() {
+    if (--pendingJoinCalls == 0) {
+        findWiFiDevice();
     }
+}
 
-    QDBusReply<QList<QDBusObjectPath>> reply = nmSettings.call("ListConnections");
+void QRCodeHandler::findWiFiDevice() {
+    setJoinState("searching");
 
-    if (!reply.isValid()) {
-        qWarning() << "Failed to list connections" << reply.error().message();
-        return false;
+    if (!networkManager->wifiDevices().isEmpty()) {
+        joinDevice = networkManager->wifiDevices().first();
+        activateConnection();
+        return;
     }
 
-    QList<QDBusObjectPath> connectionsPaths = reply.value();
-    bool ssidFound = false;
+    // The cache is still loading, ask NetworkManager directly
 
-    for (const QDBusObjectPath &path: connectionsPaths) {
-        QDBusInterface connectionSettings("org.freedesktop.NetworkManager",
-                                          path.path(),
-                                          "org.freedesktop.NetworkManager.Settings.Connection",
-                                          QDBusConnection::systemBus());
+    QDBusMessage devices = QDBusMessage::createMethodCall(NM_SERVICE, NM_PATH, NM_SERVICE, "GetDevices");
 
-        if (!connectionSettings.isValid()) {
-            qWarning() << "Failed to connect to dbus";
-            return false;
-        }
+    asyncCall(devices, [this](const QDBusMessage &reply) {
+        const QList<QDBusObjectPath> paths = qdbus_cast<QList<QDBusObjectPath>>(reply.arguments().value(0));
+        pendingJoinCalls = paths.size();
 
-        QDBusReply<Connection> settingsReply = connectionSettings.call("GetSettings");
-        if (!settingsReply.isValid()) {
-            qWarning() << "Failed to get settings for connection:" << path.path();
-            continue;
+        if (pendingJoinCalls == 0) {
+            failJoin("No Wi-Fi device found");
+            return;
         }
 
-        QMap<QString, QVariantMap> settings = settingsReply.value();
-        QString type = settings["connection"]["type"].toString();
-
-        if (type == "802-11-wireless") {
-            QString connectionSsid = settings["802-11-wireless"]["ssid"].toString();
+        for (const QDBusObjectPath &path : paths) {
+            QDBusMessage get = QDBusMessage::createMethodCall(NM_SERVICE, path.path(), "org.freedesktop.DBus.Properties", "Get");
+            get << "org.freedesktop.NetworkManager.Device" << "DeviceType";
 
-            if (connectionSsid == ssid) {
-                ssidFound = true;
-                QDBusReply<void> deleteReply = connectionSettings.call("Delete");
+            asyncCall(get, [this, path](const QDBusMessage &reply) {
+                pendingJoinCalls--;
 
-                if (!deleteReply.isValid()) {
-                    qWarning() << "Failed to delete connection:" << path.path();
-                    return false;
-                } else {
-                    qDebug() << "Successfully deleted connection with SSID:" << ssid;
-                    // break; not sure if this is a good idea ??
+                // NM_DEVICE_TYPE_WIFI, the first one to answer wins
+                if (joinDevice.isEmpty() && reply.arguments().value(0).value<QDBusVariant>().variant().toUInt() == 2) {
+                    joinDevice = path.path();
+                    activateConnection();
+                } else if (joinDevice.isEmpty() && pendingJoinCalls == 0) {
+                    failJoin("No Wi-Fi device found");
                 }
-            }
+            }, [this](const QDBusMessage &) {
+                if (--pendingJoinCalls == 0 && joinDevice.isEmpty()) {
+                    failJoin("No Wi-Fi device found");
+                }
+            });
         }
-    }
-
-    if (!ssidFound) {
-        qDebug() << "SSID not found in the list of connections. Proceeding.";
-    }
-
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-    return true;
+    });
 }
 
-bool QRCodeHandler::deactivateConnection() {
-    QDBusInterface nmProperties("org.freedesktop.NetworkManager",
-                                "/org/freedesktop/NetworkManager",
-                                "org.freedesktop.DBus.Properties",
-                                QDBusConnection::systemBus());
-
-    if (!nmProperties.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        return false;
-    }
+void QRCodeHandler::activateConnection() {
+    setJoinState("connecting");
 
-    QDBusInterface nmInterface("org.freedesktop.NetworkManager",
-                               "/org/freedesktop/NetworkManager",
-                               "org.freedesktop.NetworkManager",
-                               QDBusConnection::systemBus());
+    Connection connection;
 
-    if (!nmInterface.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        return false;
-    }
+    connection["connection"]["type"] = "802-11-wireless";
+    connection["connection"]["uuid"] = QUuid::createUuid().toString().remove('{').remove('}');
+    connection["connection"]["id"] = ssid;
+    connection["connection"]["autoconnect-retries"] = -1;
 
-    QDBusMessage reply = nmProperties.call("Get", "org.freedesktop.NetworkManager", "ActiveConnections");
+    connection["802-11-wireless"]["ssid"] = ssid.toUtf8();
+    connection["802-11-wireless"]["hidden"] = hidden;
+    connection["802-11-wireless"]["mode"] = "infrastructure";
 
-    if (reply.type() != QDBusMessage::ReplyMessage) {
-        qWarning() << "DBus query failed! reply.type() != QDBusMessage::ReplyMessage";
-        return false;
+    // Open networks have no security setting at all, key-mgmt "none" means WEP
+    if (protocol.compare("WEP", Qt::CaseInsensitive) == 0) {
+        connection["802-11-wireless-security"]["key-mgmt"] = "none";
+        connection["802-11-wireless-security"]["auth-alg"] = "open";
+        connection["802-11-wireless-security"]["wep-key0"] = password;
+        connection["802-11-wireless-security"]["wep-key-type"] = 1u;
+    } else if (protocol.compare("SAE", Qt::CaseInsensitive) == 0 || protocol.compare("WPA3", Qt::CaseInsensitive) == 0) {
+        connection["802-11-wireless-security"]["key-mgmt"] = "sae";
+        connection["802-11-wireless-security"]["psk"] = password;
+    } else if (!password.isEmpty() && protocol.compare("nopass", Qt::CaseInsensitive) != 0) {
+        connection["802-11-wireless-security"]["key-mgmt"] = "wpa-psk";
+        connection["802-11-wireless-security"]["auth-alg"] = "open";
+        connection["802-11-wireless-security"]["psk"] = password;
     }
 
-    QList<QVariant> outArgs = reply.arguments();
-    QVariant first = outArgs.at(0);
-    QDBusVariant dbvFirst = first.value<QDBusVariant>();
-    QVariant vFirst = dbvFirst.variant();
-    QDBusArgument dbusArgs = vFirst.value<QDBusArgument>();
-
-    QDBusObjectPath objPath;
-    bool deactivated = false;
-
-    dbusArgs.beginArray();
-    while (!dbusArgs.atEnd()) {
-        dbusArgs >> objPath;
-        qDebug() <<"Active connection path is: "<< objPath.path();
-
-        QDBusInterface activeConnectionProperties("org.freedesktop.NetworkManager",
-                                                  objPath.path(),
-                                                  "org.freedesktop.DBus.Properties",
-                                                  QDBusConnection::systemBus());
+    connection["ipv4"]["method"] = "auto";
+    connection["ipv4"]["dns-priority"] = 600;
+    connection["ipv6"]["method"] = "ignore";
 
-        if (!activeConnectionProperties.isValid()) {
-            qWarning() << "Failed to connect to dbus";
-            return false;
-        }
+    // Activating on the device also takes it over from the connection it had before
+    QDBusMessage add = QDBusMessage::createMethodCall(NM_SERVICE, NM_PATH, NM_SERVICE, "AddAndActivateConnection");
+    add << QVariant::fromValue(connection) << QVariant::fromValue(QDBusObjectPath(joinDevice)) << QVariant::fromValue(QDBusObjectPath("/"));
 
-        QDBusReply<QVariant> reply = activeConnectionProperties.call("Get", "org.freedesktop.NetworkManager.Connection.Active", "Type");
+    asyncCall(add, [this](const QDBusMessage &reply) {
+        joinActiveConnection = qdbus_cast<QDBusObjectPath>(reply.arguments().value(1)).path();
+        qDebug() << "Added: " << qdbus_cast<QDBusObjectPath>(reply.arguments().value(0)).path();
 
-        if (!reply.isValid()) {
-            qDebug() << "Failed to retrieve active connection type. Error:" << reply.error().message();
-        } else {
-            QString activeType = reply.value().toString();
-            qDebug() << "Active connection type is: " << activeType;
-
-            if (activeType == "802-11-wireless")  {
-                QDBusReply<void> deactivateReply = nmInterface.call("DeactivateConnection", QVariant::fromValue(objPath));
-
-                if (!deactivateReply.isValid()) {
-                    qWarning() << "Failed to deactivate path: " << objPath.path() << " " << deactivateReply.error().name() << " : " << reply.error().message();
-                    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-                    return false;
-                } else {
-                    qDebug() << "Deactivated path: " << objPath.path() << " successfully";
-                    deactivated = true;
-                }
-            }
-        }
-    }
+        QDBusConnection::systemBus().connect(NM_SERVICE, joinActiveConnection, NM_ACTIVE_CONNECTION_INTERFACE, "StateChanged",
+                                             this, SLOT(onActiveConnectionStateChanged(uint, uint)));
 
-    if (!deactivated) {
-        qDebug() << "No wireless connection was deactivated. Proceeding.";
-    }
+        // The connection may have finished activating before the signal was subscribed
+        QDBusMessage get = QDBusMessage::createMethodCall(NM_SERVICE, joinActiveConnection, "org.freedesktop.DBus.Properties", "Get");
+        get << NM_ACTIVE_CONNECTION_INTERFACE << "State";
 
-    dbusArgs.endArray();
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-    return true;
+        asyncCall(get, [this](const QDBusMessage &reply) {
+            onActiveConnectionStateChanged(reply.arguments().value(0).value<QDBusVariant>().variant().toUInt(), 0);
+        }, [](const QDBusMessage &) {});
+    });
 }
 
-void QRCodeHandler::onAccessPointAdded(const QDBusMessage &message) {
-    if (++accessPointAddedCalled > 1) {
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
+void QRCodeHandler::onActiveConnectionStateChanged(uint state, uint reason) {
+    if (joinActiveConnection.isEmpty()) {
         return;
     }
 
-    if (!QRCodeHandler::scanWiFiAccessPoints()) {
-        qWarning() << "Failed to get signal strength"; // ither failed or signal strength is 0
+    // NM_ACTIVE_CONNECTION_STATE_ACTIVATED and _DEACTIVATED
+    if (state == 2) {
+        finishJoin();
+        setJoinState("connected");
+        emit joinSucceeded(ssid);
+    } else if (state == 4) {
+        failJoin(reason == 9 ? "Wrong password" : QString("Connection failed (reason %1)").arg(reason));
     }
-
-    QDBusConnection::systemBus().disconnect(
-        "org.freedesktop.NetworkManager",
-        WiFiDevice,
-        "org.freedesktop.NetworkManager.Device.Wireless",
-        "AccessPointAdded",
-        this,
-        SLOT(onAccessPointAdded(QDBusMessage))
-    );
-
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
 }
 
-quint8 QRCodeHandler::getSignalStrength(const QString &ap) {
-    QDBusInterface device("org.freedesktop.NetworkManager",
-                          ap,
-                          "org.freedesktop.NetworkManager.AccessPoint",
-                          QDBusConnection::systemBus());
-
-    if (!device.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return 0;
-    }
-
-    QVariant getStrength = device.property("Strength");
+void QRCodeHandler::onJoinTimeout() {
+    failJoin("Timed out");
+}
 
-    if (!getStrength.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return 0;
+void QRCodeHandler::failJoin(const QString &reason) {
+    if (joinState == "failed" || joinState == "idle") {
+        return;
     }
 
-    quint8 strength = getStrength.toUInt();
-    qDebug() << "Strength: " << strength;
-
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-    return strength;
+    qWarning() << "Failed to join" << ssid << ":" << reason;
+    finishJoin();
+    setJoinState("failed");
+    emit joinFailed(ssid, reason);
 }
 
-QList<QString> QRCodeHandler::getWiFiDevices() {
-    QDBusInterface nmInterface("org.freedesktop.NetworkManager",
-                               "/org/freedesktop/NetworkManager",
-                               "org.freedesktop.NetworkManager",
-                               QDBusConnection::systemBus());
-
-    if (!nmInterface.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return QList<QString>();
-    }
+void QRCodeHandler::finishJoin() {
+    joinTimer.stop();
+    joinGeneration++;
 
-    QDBusReply<QList<QDBusObjectPath>> reply = nmInterface.call("GetDevices");
-    if (!reply.isValid()) {
-        qWarning() << "Failed to get devices";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return QList<QString>();
+    if (!joinActiveConnection.isEmpty()) {
+        QDBusConnection::systemBus().disconnect(NM_SERVICE, joinActiveConnection, NM_ACTIVE_CONNECTION_INTERFACE, "StateChanged",
+                                                this, SLOT(onActiveConnectionStateChanged(uint, uint)));
+        joinActiveConnection.clear();
     }
+}
 
-    QList<QString> devices;
-    for (const QDBusObjectPath &path: reply.value()) {
-        QDBusInterface device("org.freedesktop.NetworkManager",
-                              path.path(),
-                              "org.freedesktop.NetworkManager.Device",
-                              QDBusConnection::systemBus());
-
-        QVariant deviceType = device.property("DeviceType");
-
-        if (!deviceType.isValid()) {
-            continue;
-        } else if (deviceType.toUInt() == 2) {
-            devices.append(path.path());
-        }
+void QRCodeHandler::setJoinState(const QString &state) {
+    if (joinState != state) {
+        joinState = state;
+        emit joinStateChanged();
     }
-
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-    return devices;
 }
 
-bool QRCodeHandler::scanWiFiAccessPoints() {
-    QList<QString> WiFiDevices = QRCodeHandler::getWiFiDevices();
-
-    if (!WiFiDevices.isEmpty()) {
-        QString device = WiFiDevices.at(0);
+QString QRCodeHandler::getJoinState() const {
+    return joinState;
+}
 
-        QDBusInterface WiFi("org.freedesktop.NetworkManager",
-                            device,
-                            "org.freedesktop.NetworkManager.Device.Wireless",
-                            QDBusConnection::systemBus());
+void QRCodeHandler::asyncCall(const QDBusMessage &message, std::function<void(const QDBusMessage &)> onReply,
+                              std::function<void(const QDBusMessage &)> onError) {
+    const quint32 generation = joinGeneration;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
 
-        QDBusReply<QList<QDBusObjectPath>> ap = WiFi.call("GetAllAccessPoints");
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, generation, onReply, onError](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
 
-        if (!ap.isValid()) {
-            qWarning() << "Failed to get Access Points";
-            QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-            return false;
+        // Replies for a join that was superseded, failed or finished are dropped
+        if (generation != joinGeneration) {
+            return;
         }
 
-        for (const QDBusObjectPath &apPath: ap.value()) {
-            QDBusInterface apInterface("org.freedesktop.NetworkManager",
-                                       apPath.path(),
-                                       "org.freedesktop.NetworkManager.AccessPoint",
-                                       QDBusConnection::systemBus());
-
-            QVariant reply = apInterface.property("Ssid");
-            qDebug() << "Access Point: " << apPath.path();
-
-            if (reply.isValid()) {
-                QString apSsid = QString::fromUtf8(reply.toByteArray());
-
-                if (apSsid == ssid) {
-                    qDebug() << "Access Point Ssid: " << apSsid;
-                    getSignalStrength(apPath.path());
-                    return true;
-                }
+        const QDBusMessage reply = watcher->reply();
 
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            if (onError) {
+                onError(reply);
             } else {
-                qWarning() << "Failed to get SSID of Access Point: " << apPath.path();
-                QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-                return false;
+                failJoin(reply.errorName() + ": " + reply.errorMessage());
             }
+        } else {
+            onReply(reply);
         }
-    }
-
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-    return false;
+    });
 }
 
-quint8 QRCodeHandler::scanWiFiAccessPointsForSignalStrength() {
-    QList<QString> WiFiDevices = QRCodeHandler::getWiFiDevices();
-
-    if (!WiFiDevices.isEmpty()) {
-        QString device = WiFiDevices.at(0);
-
-        QDBusInterface WiFi("org.freedesktop.NetworkManager",
-                            device,
-                            "org.freedesktop.NetworkManager.Device.Wireless",
-                            QDBusConnection::systemBus());
-
-        QDBusReply<QList<QDBusObjectPath>> ap = WiFi.call("GetAllAccessPoints");
-
-        if (!ap.isValid()) {
-            qWarning() << "Failed to get Access Points";
-            QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-            return 0;
-        }
-
-        for (const QDBusObjectPath &apPath: ap.value()) {
-            QDBusInterface apInterface("org.freedesktop.NetworkManager",
-                                       apPath.path(),
-                                       "org.freedesktop.NetworkManager.AccessPoint",
-                                       QDBusConnection::systemBus());
-
-            QVariant reply = apInterface.property("Ssid");
-            qDebug() << "Access Point: " << apPath.path();
-
-            if (reply.isValid()) {
-                QString apSsid = QString::fromUtf8(reply.toByteArray());
-
-                if (apSsid == ssid) {
-                    qDebug() << "Access Point Ssid: " << apSsid;
-
-                    return getSignalStrength(apPath.path());
-                }
-
-            } else {
-                qWarning() << "Failed to get SSID of Access Point: " << apPath.path();
-                QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-                return 0;
-            }
-        }
-    }
+quint8 QRCodeHandler::getSignalStrength(const QString &ap) {
+    return networkManager->accessPointStrength(ap);
+}
 
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-    return 0;
+QList<QString> QRCodeHandler::getWiFiDevices() {
+    return networkManager->wifiDevices();
 }
 
 bool QRCodeHandler::getWiFiEnabled() {
-    QDBusInterface wifi("org.freedesktop.NetworkManager",
-                        "/org/freedesktop/NetworkManager",
-                        "org.freedesktop.NetworkManager",
-                        QDBusConnection::systemBus());
-
-    if (!wifi.isValid()) {
-        qWarning() << "Failed to connect to dbus";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return false;
-    }
-
-    QVariant reply = wifi.property("WirelessEnabled");
-    
-    if (!reply.isValid()) {
-        qWarning() << "Failed to get WirelessEnabled";
-        QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-        return false;
-    }
-
-    bool enabled = reply.toBool();
-    
-    QDBusConnection::systemBus().disconnectFromBus(QDBusConnection::systemBus().name());
-    return enabled;
+    return networkManager->wirelessEnabled();
 }
 
 QString QRCodeHandler::getSignalStrengthIcon() {
-    if (!getWiFiEnabled()) {
-        return OFFLINE_SIGNAL;
-    }
+    return signalMonitor->signalIcon();
+}
 
-    quint8 strength = scanWiFiAccessPointsForSignalStrength();
-
-    if (strength <= 0)
-        return NO_ROUTE_SIGNAL;
-    else if (strength < 20)
-        return NONE_SIGNAL;
-    else if (strength < 40)
-        return WEAK_SIGNAL;
-    else if (strength < 50)
-        return OK_SIGNAL;
-    else if (strength < 80)
-        return GOOD_SIGNAL;
-    else
-        return EXCELLENT_SIGNAL;
+int QRCodeHandler::getSignalStrengthValue() {
+    return signalMonitor->signalStrength();
 }
 
 QString QRCodeHandler::getWifiId() {
     return ssid;
 }
+
+QString QRCodeHandler::getContactSummary() {
+    return contactSummary;
+}
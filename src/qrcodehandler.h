@@ -10,44 +10,74 @@
 
 #include <QObject>
 #include <QDBusMessage>
-
-#define NO_ROUTE_SIGNAL QString("icons/network-wireless-signal-no-route.svg")
-#define OFFLINE_SIGNAL QString("icons/network-wireless-signal-offline.svg")
-#define NONE_SIGNAL QString("icons/network-wireless-signal-none.svg")
-#define WEAK_SIGNAL QString("icons/network-wireless-signal-weak.svg")
-#define OK_SIGNAL QString("icons/network-wireless-signal-ok.svg")
-#define GOOD_SIGNAL QString("icons/network-wireless-signal-good.svg")
-#define EXCELLENT_SIGNAL QString("icons/network-wireless-signal-excellent.svg")
+#include <QTimer>
+#include <functional>
 
 typedef QMap<QString, QVariantMap> Connection;
 
+class NetworkManagerClient;
+class WifiSignalMonitor;
+class WifiConnectionIndex;
+
 class QRCodeHandler : public QObject {
     Q_OBJECT
+    // idle, enabling, forgetting, searching, connecting, connected or failed
+    Q_PROPERTY(QString joinState READ getJoinState NOTIFY joinStateChanged)
+    // Of the network from the last scanned Wi-Fi code, updated as NetworkManager reports it
+    Q_PROPERTY(int signalStrength READ getSignalStrengthValue NOTIFY signalChanged)
+    Q_PROPERTY(QString signalIcon READ getSignalStrengthIcon NOTIFY signalChanged)
 
 public:
     explicit QRCodeHandler(QObject *parent = nullptr);
     Q_INVOKABLE QString parseQrString(const QString &qrString);
     Q_INVOKABLE void openUrlInFirefox(const QString &url);
+    // Returns immediately, progress is reported through joinState and the join signals
     Q_INVOKABLE void connectToWifi();
-    bool forgetConnection();
-    bool deactivateConnection();
+    QString getJoinState() const;
     quint8 getSignalStrength(const QString &ap);
     QList<QString> getWiFiDevices(); 
-    bool scanWiFiAccessPoints();
     Q_INVOKABLE QString getWifiId();
+    Q_INVOKABLE QString getContactSummary();
     Q_INVOKABLE QString getSignalStrengthIcon();
+    int getSignalStrengthValue();
     bool getWiFiEnabled();
-    quint8 scanWiFiAccessPointsForSignalStrength();
 
-public slots:
-    void onAccessPointAdded(const QDBusMessage &message);
+signals:
+    void joinStateChanged();
+    void signalChanged();
+    void joinSucceeded(const QString &ssid);
+    void joinFailed(const QString &ssid, const QString &reason);
+
+private slots:
+    void onActiveConnectionStateChanged(uint state, uint reason);
+    void onJoinTimeout();
 
 private:
+    void forgetConnections();
+    void deleteConnection(const QString &path);
+    void forgetConnectionDone();
+    void findWiFiDevice();
+    void activateConnection();
+    void failJoin(const QString &reason);
+    void finishJoin();
+    void setJoinState(const QString &state);
+    void asyncCall(const QDBusMessage &message, std::function<void(const QDBusMessage &)> onReply,
+                   std::function<void(const QDBusMessage &)> onError = nullptr);
+
+    NetworkManagerClient *networkManager;
+    WifiSignalMonitor *signalMonitor;
+    WifiConnectionIndex *connectionIndex;
     QString protocol = "";
     QString ssid = "";
     QString password = "";
-    QString WiFiDevice = "";
-    int accessPointAddedCalled = 0;
+    bool hidden = false;
+    QString contactSummary = "";
+    QString joinState = "idle";
+    QString joinDevice = "";
+    QString joinActiveConnection = "";
+    quint32 joinGeneration = 0;
+    int pendingJoinCalls = 0;
+    QTimer joinTimer;
 };
 
 #endif // QRCODEHANDLER_H
\ No newline at end of file
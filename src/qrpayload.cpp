@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "qrpayload.h"
+
+static bool isWordChar(QChar c)
+{
+    const ushort u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_';
+}
+
+static bool isHostChar(QChar c)
+{
+    return isWordChar(c) || c == '.' || c == '-';
+}
+
+static bool isUrlChar(QChar c)
+{
+    if (isWordChar(c))
+        return true;
+
+    switch (c.unicode()) {
+    case '-': case '.': case '_': case '~': case ':': case '/': case '?': case '#':
+    case '[': case ']': case '@': case '!': case '$': case '&': case '\'': case '(':
+    case ')': case '*': case '+': case ',': case ';': case '=': case '%':
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Same language as the old "^(?:http(s)?://)?[\w.-]+(?:\.[\w.-]+)+[...]*$" pattern,
+// plus percent escapes, decided in one scan without backtracking: the leading host
+// run needs a dot with something on both sides, everything after it only has to
+// be a valid URL character
+static bool isUrl(const QString &text)
+{
+    int pos = 0;
+    if (text.startsWith("http://", Qt::CaseInsensitive))
+        pos = 7;
+    else if (text.startsWith("https://", Qt::CaseInsensitive))
+        pos = 8;
+
+    const int hostStart = pos;
+    bool dotInside = false;
+
+    for (; pos < text.size() && isHostChar(text[pos]); pos++) {
+        if (text[pos] == '.' && pos > hostStart && pos + 1 < text.size() && isHostChar(text[pos + 1]))
+            dotInside = true;
+    }
+
+    if (!dotInside)
+        return false;
+
+    for (; pos < text.size(); pos++) {
+        if (!isUrlChar(text[pos]))
+            return false;
+    }
+
+    return true;
+}
+
+// Walks "KEY:value;KEY:value;;" as used by WIFI: and MECARD:, where a backslash
+// escapes the next character in a value and a value may be wrapped in quotes
+template <typename Callback>
+static void forEachField(const QString &text, int pos, Callback callback)
+{
+    QString key;
+    QString value;
+    bool inValue = false;
+    bool quoted = false;
+    bool endsWithQuote = false;
+
+    auto finishField = [&]() {
+        if (quoted && endsWithQuote && value.size() >= 2)
+            value = value.mid(1, value.size() - 2);
+        if (!key.isEmpty())
+            callback(key, value);
+        key.clear();
+        value.clear();
+        inValue = false;
+        quoted = false;
+        endsWithQuote = false;
+    };
+
+    for (; pos < text.size(); pos++) {
+        const QChar c = text[pos];
+
+        if (!inValue) {
+            if (c == ':')
+                inValue = true;
+            else if (c == ';')
+                finishField();
+            else
+                key.append(c.toUpper());
+            continue;
+        }
+
+        if (c == '\\' && pos + 1 < text.size()) {
+            value.append(text[++pos]);
+            endsWithQuote = false;
+        } else if (c == ';') {
+            finishField();
+        } else {
+            if (c == '"') {
+                if (value.isEmpty())
+                    quoted = true;
+                endsWithQuote = true;
+            } else {
+                endsWithQuote = false;
+            }
+            value.append(c);
+        }
+    }
+
+    if (inValue || !key.isEmpty())
+        finishField();
+}
+
+static bool parseWifi(const QString &text, QrPayload &payload)
+{
+    forEachField(text, 5, [&payload](const QString &key, const QString &value) {
+        if (key == "S")
+            payload.ssid = value;
+        else if (key == "T")
+            payload.security = value;
+        else if (key == "P")
+            payload.password = value;
+        else if (key == "H")
+            payload.hidden = value.compare("true", Qt::CaseInsensitive) == 0;
+    });
+
+    if (payload.ssid.isEmpty())
+        return false;
+
+    payload.type = QrPayload::Wifi;
+    return true;
+}
+
+static bool parseMeCard(const QString &text, QrPayload &payload)
+{
+    forEachField(text, 7, [&payload](const QString &key, const QString &value) {
+        if (key == "N" && payload.name.isEmpty()) {
+            // "Last,First" is the usual order
+            const int comma = value.indexOf(',');
+            payload.name = comma < 0 ? value : value.mid(comma + 1).trimmed() + " " + value.left(comma).trimmed();
+        } else if (key == "TEL" && payload.phone.isEmpty()) {
+            payload.phone = value;
+        } else if (key == "EMAIL" && payload.email.isEmpty()) {
+            payload.email = value;
+        }
+    });
+
+    if (payload.name.isEmpty() && payload.phone.isEmpty() && payload.email.isEmpty())
+        return false;
+
+    payload.type = QrPayload::MeCard;
+    return true;
+}
+
+static QString unescapeVCardValue(const QStringRef &value)
+{
+    QString result;
+    result.reserve(value.size());
+
+    for (int i = 0; i < value.size(); i++) {
+        if (value.at(i) == '\\' && i + 1 < value.size()) {
+            const QChar next = value.at(++i);
+            result.append(next == 'n' || next == 'N' ? QChar('\n') : next);
+        } else {
+            result.append(value.at(i));
+        }
+    }
+
+    return result;
+}
+
+static bool parseVCard(const QString &text, QrPayload &payload)
+{
+    QString structuredName;
+    int lineStart = 0;
+
+    while (lineStart < text.size()) {
+        int lineEnd = text.indexOf('\n', lineStart);
+        if (lineEnd < 0)
+            lineEnd = text.size();
+
+        int length = lineEnd - lineStart;
+        if (length > 0 && text[lineEnd - 1] == '\r')
+            length--;
+
+        const QStringRef line = text.midRef(lineStart, length);
+        lineStart = lineEnd + 1;
+
+        const int colon = line.indexOf(':');
+        if (colon <= 0)
+            continue;
+
+        // "TEL;TYPE=cell:+123" -> "TEL", properties may also carry a group prefix
+        QStringRef property = line.left(colon);
+        const int parameters = property.indexOf(';');
+        if (parameters >= 0)
+            property = property.left(parameters);
+        const int group = property.lastIndexOf('.');
+        if (group >= 0)
+            property = property.mid(group + 1);
+
+        const QStringRef value = line.mid(colon + 1);
+
+        if (property.compare(QLatin1String("FN"), Qt::CaseInsensitive) == 0 && payload.name.isEmpty()) {
+            payload.name = unescapeVCardValue(value);
+        } else if (property.compare(QLatin1String("N"), Qt::CaseInsensitive) == 0 && structuredName.isEmpty()) {
+            // "Last;First;Middle;Prefix;Suffix"
+            const QVector<QStringRef> parts = value.split(';');
+            structuredName = parts.size() > 1 ? (parts[1].toString() + " " + parts[0].toString()).trimmed() : parts[0].toString();
+        } else if (property.compare(QLatin1String("TEL"), Qt::CaseInsensitive) == 0 && payload.phone.isEmpty()) {
+            payload.phone = unescapeVCardValue(value);
+        } else if (property.compare(QLatin1String("EMAIL"), Qt::CaseInsensitive) == 0 && payload.email.isEmpty()) {
+            payload.email = unescapeVCardValue(value);
+        }
+    }
+
+    if (payload.name.isEmpty())
+        payload.name = structuredName;
+
+    payload.type = QrPayload::VCard;
+    return true;
+}
+
+static bool parseGeo(const QString &text, QrPayload &payload)
+{
+    const int comma = text.indexOf(',', 4);
+    if (comma < 0)
+        return false;
+
+    int end = comma + 1;
+    while (end < text.size() && text[end] != ',' && text[end] != ';' && text[end] != '?')
+        end++;
+
+    bool latitudeOk = false;
+    bool longitudeOk = false;
+    const double latitude = text.midRef(4, comma - 4).trimmed().toDouble(&latitudeOk);
+    const double longitude = text.midRef(comma + 1, end - comma - 1).trimmed().toDouble(&longitudeOk);
+
+    if (!latitudeOk || !longitudeOk || latitude < -90 || latitude > 90 || longitude < -180 || longitude > 180)
+        return false;
+
+    payload.latitude = latitude;
+    payload.longitude = longitude;
+    payload.type = QrPayload::Geo;
+    return true;
+}
+
+static bool parseTel(const QString &text, QrPayload &payload)
+{
+    bool hasDigit = false;
+    int pos = 4;
+
+    for (; pos < text.size() && text[pos] != ';'; pos++) {
+        const QChar c = text[pos];
+        if (c.isDigit())
+            hasDigit = true;
+        else if (c != '+' && c != '-' && c != '.' && c != '(' && c != ')' && c != ' ' && c != '*' && c != '#')
+            return false;
+    }
+
+    if (!hasDigit)
+        return false;
+
+    payload.address = text.mid(4, pos - 4).trimmed();
+    payload.type = QrPayload::Tel;
+    return true;
+}
+
+static bool parseMailto(const QString &text, QrPayload &payload)
+{
+    int end = text.indexOf('?', 7);
+    if (end < 0)
+        end = text.size();
+
+    const int at = text.indexOf('@', 7);
+    if (at <= 7 || at >= end - 1)
+        return false;
+
+    payload.address = text.mid(7, end - 7);
+    payload.type = QrPayload::Mailto;
+    return true;
+}
+
+QrPayload parseQrPayload(const QString &text)
+{
+    QrPayload payload;
+
+    // Every check below only looks at a short prefix before committing to one parser
+    if (text.startsWith("WIFI:", Qt::CaseInsensitive))
+        parseWifi(text, payload);
+    else if (text.startsWith("MECARD:", Qt::CaseInsensitive))
+        parseMeCard(text, payload);
+    else if (text.startsWith("BEGIN:VCARD", Qt::CaseInsensitive))
+        parseVCard(text, payload);
+    else if (text.startsWith("geo:", Qt::CaseInsensitive))
+        parseGeo(text, payload);
+    else if (text.startsWith("tel:", Qt::CaseInsensitive))
+        parseTel(text, payload);
+    else if (text.startsWith("mailto:", Qt::CaseInsensitive))
+        parseMailto(text, payload);
+    else if (isUrl(text))
+        payload.type = QrPayload::Url;
+
+    return payload;
+}
+
+QString QrPayload::typeName() const
+{
+    switch (type) {
+    case Url:
+        return QStringLiteral("URL");
+    case Wifi:
+        return QStringLiteral("WIFI");
+    case MeCard:
+        return QStringLiteral("MECARD");
+    case VCard:
+        return QStringLiteral("VCARD");
+    case Geo:
+        return QStringLiteral("GEO");
+    case Tel:
+        return QStringLiteral("TEL");
+    case Mailto:
+        return QStringLiteral("MAILTO");
+    default:
+        return QString();
+    }
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef QRPAYLOAD_H
+#define QRPAYLOAD_H
+
+#include <QString>
+
+// What a scanned code contains, classified and tokenized in a single pass over
+// the text without any regular expression work
+struct QrPayload {
+    enum Type {
+        Unknown,
+        Url,
+        Wifi,
+        MeCard,
+        VCard,
+        Geo,
+        Tel,
+        Mailto
+    };
+
+    Type type = Unknown;
+
+    // Wi-Fi network, security is the T: field as given ("WPA", "SAE", "WEP", "nopass", ...)
+    QString ssid;
+    QString security;
+    QString password;
+    bool hidden = false;
+
+    // MECARD / vCard contact
+    QString name;
+    QString phone;
+    QString email;
+
+    // geo: URI
+    double latitude = 0;
+    double longitude = 0;
+
+    // Number of a tel: URI, address of a mailto: URI
+    QString address;
+
+    // Name used by QML, "URL", "WIFI", "MECARD", "VCARD", "GEO", "TEL", "MAILTO" or empty
+    QString typeName() const;
+};
+
+QrPayload parseQrPayload(const QString &text);
+
+#endif // QRPAYLOAD_H
@@ -24,6 +24,9 @@ void SettingsManager::fetchSettingsFromQML() {
 
         if (settingsObject) {
             m_gpsOn = settingsObject->property("gpsOn").toBool();
+            m_gpsMaxFixAge = settingsObject->property("gpsMaxFixAge").toInt();
+            m_gpsUpgradeWindow = settingsObject->property("gpsUpgradeWindow").toInt();
+            m_standbyTimeout = settingsObject->property("standbyTimeout").toInt();
         }
     }
 }
@@ -31,3 +34,15 @@ void SettingsManager::fetchSettingsFromQML() {
 bool SettingsManager::gpsOn() const {
     return m_gpsOn;
 }
+
+int SettingsManager::gpsMaxFixAge() const {
+    return m_gpsMaxFixAge;
+}
+
+int SettingsManager::gpsUpgradeWindow() const {
+    return m_gpsUpgradeWindow;
+}
+
+int SettingsManager::standbyTimeout() const {
+    return m_standbyTimeout;
+}
@@ -18,10 +18,16 @@ public:
     void initialize(QQmlApplicationEngine *engine);
 
     bool gpsOn() const;
+    int gpsMaxFixAge() const;
+    int gpsUpgradeWindow() const;
+    int standbyTimeout() const;
 
 private:
     QQmlApplicationEngine *m_engine = nullptr;
     mutable bool m_gpsOn = false;
+    int m_gpsMaxFixAge = 900;
+    int m_gpsUpgradeWindow = 30;
+    int m_standbyTimeout = 60;
 
     SettingsManager() {}
     void fetchSettingsFromQML();
@@ -5,18 +5,115 @@
 // Bardia Moshiri <bardia@furilabs.com>
 
 #include "singleinstance.h"
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
 #include <QLocalSocket>
 
+static const QStringList CAMERA_ACTIONS = {"photo", "video", "scan", "timer"};
+
+// The running instance only queues the request, so this is normally a few ms.
+// It can take longer while that instance is still loading its QML, the request
+// then stays queued on the bus and is handled once it gets to its event loop.
+#define HANDOVER_TIMEOUT 1000
+
 SingleInstance::SingleInstance(QObject *parent) : QObject(parent), m_server(new QLocalServer(this)) {
     connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::onNewConnection);
 }
 
-bool SingleInstance::listen(const QString &serverName) {
+bool SingleInstance::listen(const QString &serverName, const QString &intent) {
+    if (QDBusConnection::sessionBus().isConnected()) {
+        if (registerOnSessionBus()) {
+            // Also answers launches that have no session bus
+            m_server->removeServer(serverName);
+            m_server->listen(serverName);
+            return true;
+        }
+        if (handOverOnSessionBus(intent)) {
+            return false;
+        }
+        qDebug() << "Can't reach the running instance over D-Bus, trying the local socket";
+    }
+
+    return listenLocal(serverName, intent);
+}
+
+bool SingleInstance::parseIntent(const QString &intent, QString *action, QVariant *parameter) {
+    const int separator = intent.indexOf('=');
+    const QString name = separator < 0 ? intent : intent.left(separator);
+
+    if (!CAMERA_ACTIONS.contains(name)) {
+        return false;
+    }
+
+    *action = name;
+    *parameter = QVariant();
+
+    if (separator >= 0) {
+        bool ok = false;
+        const int value = intent.mid(separator + 1).toInt(&ok);
+        if (!ok) {
+            return false;
+        }
+        *parameter = value;
+    }
+
+    return true;
+}
+
+bool SingleInstance::registerOnSessionBus() {
+    QDBusConnection bus = QDBusConnection::sessionBus();
+
+    // The adaptor is in place before the name is taken, so a request can't
+    // arrive for an object that isn't there yet
+    new ApplicationAdaptor(this);
+    if (!bus.registerObject(CAMERA_DBUS_PATH, this)) {
+        return false;
+    }
+
+    const QDBusConnectionInterface::RegisterServiceReply reply = bus.interface()->registerService(
+        CAMERA_DBUS_SERVICE, QDBusConnectionInterface::DontQueueService, QDBusConnectionInterface::DontAllowReplacement);
+
+    if (reply.isValid() && reply.value() == QDBusConnectionInterface::ServiceRegistered) {
+        return true;
+    }
+
+    bus.unregisterObject(CAMERA_DBUS_PATH);
+    return false;
+}
+
+bool SingleInstance::handOverOnSessionBus(const QString &intent) {
+    QString action;
+    QVariant parameter;
+    QDBusMessage message;
+
+    if (parseIntent(intent, &action, &parameter)) {
+        message = QDBusMessage::createMethodCall(CAMERA_DBUS_SERVICE, CAMERA_DBUS_PATH,
+                                                 "org.freedesktop.Application", "ActivateAction");
+        message << action << (parameter.isValid() ? QVariantList{parameter} : QVariantList()) << QVariantMap();
+    } else {
+        message = QDBusMessage::createMethodCall(CAMERA_DBUS_SERVICE, CAMERA_DBUS_PATH,
+                                                 "org.freedesktop.Application", "Activate");
+        message << QVariantMap();
+    }
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    const QDBusMessage reply = bus.call(message, QDBus::Block, HANDOVER_TIMEOUT);
+    if (reply.type() == QDBusMessage::ReplyMessage) {
+        return true;
+    }
+
+    // A slow reply still means the request was delivered to the owner, which
+    // would otherwise be started a second time next to it
+    return bus.interface()->isServiceRegistered(CAMERA_DBUS_SERVICE);
+}
+
+bool SingleInstance::listenLocal(const QString &serverName, const QString &intent) {
     if (!m_server->listen(serverName)) {
         QLocalSocket socket;
         socket.connectToServer(serverName);
         if (socket.waitForConnected(500)) {
-            socket.write("SHOW");
+            socket.write(intent.isEmpty() ? QByteArray("SHOW") : "SHOW " + intent.toUtf8());
             socket.waitForBytesWritten();
             return false;
         }
@@ -26,13 +123,59 @@ bool SingleInstance::listen(const QString &serverName) {
     return true;
 }
 
+void SingleInstance::activate(const QString &intent) {
+    emit showWindow();
+
+    QString action;
+    QVariant parameter;
+    if (parseIntent(intent, &action, &parameter)) {
+        emit actionRequested(action, parameter);
+    }
+}
+
 void SingleInstance::onNewConnection() {
     QLocalSocket *socket = m_server->nextPendingConnection();
     if (socket) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
         connect(socket, &QLocalSocket::readyRead, [this, socket]() {
-            if (socket->readAll() == "SHOW") {
-                emit showWindow();
+            const QByteArray request = socket->readAll();
+            if (request == "SHOW" || request.startsWith("SHOW ")) {
+                activate(QString::fromUtf8(request.mid(5)));
             }
         });
     }
 }
+
+ApplicationAdaptor::ApplicationAdaptor(SingleInstance *parent)
+    : QDBusAbstractAdaptor(parent), m_instance(parent)
+{
+}
+
+void ApplicationAdaptor::Activate(const QVariantMap &platformData) {
+    Q_UNUSED(platformData);
+
+    // Queued so the caller gets its reply before the window is shown
+    QMetaObject::invokeMethod(m_instance, [this]() { m_instance->activate(QString()); }, Qt::QueuedConnection);
+}
+
+void ApplicationAdaptor::Open(const QStringList &uris, const QVariantMap &platformData) {
+    Q_UNUSED(uris);
+
+    // There are no documents to open, bring the window up
+    Activate(platformData);
+}
+
+void ApplicationAdaptor::ActivateAction(const QString &actionName, const QVariantList &parameter, const QVariantMap &platformData) {
+    Q_UNUSED(platformData);
+
+    QString intent = actionName;
+    if (!parameter.isEmpty()) {
+        QVariant value = parameter.first();
+        if (value.canConvert<QDBusVariant>()) {
+            value = value.value<QDBusVariant>().variant();
+        }
+        intent += "=" + value.toString();
+    }
+
+    QMetaObject::invokeMethod(m_instance, [this, intent]() { m_instance->activate(intent); }, Qt::QueuedConnection);
+}
@@ -8,20 +8,59 @@
 
 #include <QObject>
 #include <QLocalServer>
+#include <QDBusAbstractAdaptor>
+#include <QVariant>
 
+#define CAMERA_DBUS_SERVICE "io.furios.Camera"
+#define CAMERA_DBUS_PATH "/io/furios/Camera"
+#define CAMERA_CONTROL_DBUS_PATH "/io/furios/Camera/Control"
+
+// Owns io.furios.Camera on the session bus and takes launches handed over by
+// later instances through org.freedesktop.Application. Without a session bus
+// it falls back to a QLocalServer carrying the same requests.
 class SingleInstance : public QObject
 {
     Q_OBJECT
 public:
     explicit SingleInstance(QObject *parent = nullptr);
-    bool listen(const QString &serverName);
+
+    // False when another instance is running, the intent has then been handed to it.
+    // An intent is an action name with an optional value, "video" or "timer=3".
+    bool listen(const QString &serverName, const QString &intent = QString());
+
+    static bool parseIntent(const QString &intent, QString *action, QVariant *parameter);
 
 signals:
     void showWindow();
+    // Always follows a showWindow
+    void actionRequested(const QString &action, const QVariant &parameter);
 
 private slots:
     void onNewConnection();
 
 private:
+    friend class ApplicationAdaptor;
+
+    bool registerOnSessionBus();
+    bool handOverOnSessionBus(const QString &intent);
+    bool listenLocal(const QString &serverName, const QString &intent);
+    void activate(const QString &intent);
+
     QLocalServer *m_server;
 };
+
+class ApplicationAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Application")
+public:
+    explicit ApplicationAdaptor(SingleInstance *parent);
+
+public slots:
+    void Activate(const QVariantMap &platformData);
+    void Open(const QStringList &uris, const QVariantMap &platformData);
+    void ActivateAction(const QString &actionName, const QVariantList &parameter, const QVariantMap &platformData);
+
+private:
+    SingleInstance *m_instance;
+};
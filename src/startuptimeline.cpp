@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "startuptimeline.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <time.h>
+
+static qint64 monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+StartupTimeline& StartupTimeline::instance() {
+    static StartupTimeline _instance;
+    return _instance;
+}
+
+StartupTimeline::StartupTimeline() : m_path(qEnvironmentVariable("FURIOS_CAMERA_STARTUP_LOG")) {
+}
+
+bool StartupTimeline::isEnabled() const {
+    return !m_path.isEmpty();
+}
+
+void StartupTimeline::mark(const QString &name) {
+    if (m_path.isEmpty()) {
+        return;
+    }
+
+    const qint64 now = monotonicNs();
+    QMutexLocker locker(&m_mutex);
+
+    for (const Milestone &milestone : m_milestones) {
+        if (milestone.name == name) {
+            return;
+        }
+    }
+
+    m_milestones.append({name, now});
+
+    // Marks can come from the render thread, which must not wait on the disk
+    if (name == "firstVideoFrame") {
+        QMetaObject::invokeMethod(this, &StartupTimeline::flush, Qt::QueuedConnection);
+    }
+}
+
+void StartupTimeline::flush() {
+    if (m_path.isEmpty()) {
+        return;
+    }
+
+    m_mutex.lock();
+    const QVector<Milestone> marked = m_milestones;
+    m_mutex.unlock();
+
+    if (marked.isEmpty()) {
+        return;
+    }
+
+    const qint64 start = marked.first().monotonicNs;
+    QJsonArray milestones;
+
+    for (const Milestone &milestone : marked) {
+        milestones.append(QJsonObject{
+            {"name", milestone.name},
+            // CLOCK_MONOTONIC is shared by every process, so a launcher can
+            // compare these with its own timestamps
+            {"monotonicNs", milestone.monotonicNs},
+            {"sinceFirstMs", (milestone.monotonicNs - start) / 1e6},
+        });
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+
+    QSaveFile file(m_path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(QJsonObject{
+            {"pid", QCoreApplication::applicationPid()},
+            {"milestones", milestones},
+        }).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+class FirstFrameRunnable : public QVideoFilterRunnable {
+public:
+    explicit FirstFrameRunnable(FirstFrameProbe *probe) : m_probe(probe) {}
+
+    QVideoFrame run(QVideoFrame *input, const QVideoSurfaceFormat &surfaceFormat, RunFlags flags) override {
+        Q_UNUSED(surfaceFormat);
+        Q_UNUSED(flags);
+
+        // Runs on the render thread
+        if (m_probe->isActive()) {
+            StartupTimeline::instance().mark("firstVideoFrame");
+            FirstFrameProbe *probe = m_probe;
+            QMetaObject::invokeMethod(probe, [probe]() { probe->setActive(false); }, Qt::QueuedConnection);
+        }
+
+        return *input;
+    }
+
+private:
+    FirstFrameProbe *m_probe;
+};
+
+FirstFrameProbe::FirstFrameProbe(QObject *parent) : QAbstractVideoFilter(parent) {
+    setActive(StartupTimeline::instance().isEnabled());
+}
+
+QVideoFilterRunnable *FirstFrameProbe::createFilterRunnable() {
+    return new FirstFrameRunnable(this);
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+#include <QAbstractVideoFilter>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+// Monotonic timestamps of the cold start milestones, from main() to the first
+// viewfinder frame. Only recorded when FURIOS_CAMERA_STARTUP_LOG names a file.
+// Milestones are kept in memory and the file is written as JSON on the GUI
+// thread once the first frame is marked, and again at quit.
+class StartupTimeline : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled CONSTANT)
+public:
+    static StartupTimeline& instance();
+
+    bool isEnabled() const;
+
+    // Safe from any thread, only the first mark of each name is kept
+    Q_INVOKABLE void mark(const QString &name);
+    // Writes the milestones so far, from the GUI thread
+    void flush();
+
+private:
+    struct Milestone {
+        QString name;
+        qint64 monotonicNs;
+    };
+
+    StartupTimeline();
+
+    QString m_path;
+    QMutex m_mutex;
+    QVector<Milestone> m_milestones;
+};
+
+// Video filter that marks the first frame reaching the VideoOutput, then
+// switches itself off
+class FirstFrameProbe : public QAbstractVideoFilter {
+    Q_OBJECT
+public:
+    explicit FirstFrameProbe(QObject *parent = nullptr);
+    QVideoFilterRunnable *createFilterRunnable() override;
+};
+
+#endif // STARTUPTIMELINE_H
@@ -0,0 +1,340 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "statusnotifieritem.h"
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QDebug>
+
+#define WATCHER_SERVICE "org.kde.StatusNotifierWatcher"
+#define WATCHER_PATH "/StatusNotifierWatcher"
+#define ITEM_PATH "/StatusNotifierItem"
+#define MENU_PATH "/MenuBar"
+
+// The whole menu, the root and its only entry
+#define MENU_ROOT_ID 0
+#define MENU_QUIT_ID 1
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuLayoutItem &item)
+{
+    argument.beginStructure();
+    argument << item.id << item.properties;
+    argument.beginArray(qMetaTypeId<QDBusVariant>());
+    for (const QVariant &child : item.children) {
+        argument << QDBusVariant(child);
+    }
+    argument.endArray();
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuLayoutItem &item)
+{
+    argument.beginStructure();
+    argument >> item.id >> item.properties;
+    argument.beginArray();
+    item.children.clear();
+    while (!argument.atEnd()) {
+        QDBusVariant child;
+        argument >> child;
+        item.children.append(child.variant());
+    }
+    argument.endArray();
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuItem &item)
+{
+    argument.beginStructure();
+    argument << item.id << item.properties;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuItem &item)
+{
+    argument.beginStructure();
+    argument >> item.id >> item.properties;
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuItemKeys &item)
+{
+    argument.beginStructure();
+    argument << item.id << item.properties;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuItemKeys &item)
+{
+    argument.beginStructure();
+    argument >> item.id >> item.properties;
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuEvent &event)
+{
+    argument.beginStructure();
+    argument << event.id << event.eventId << event.data << event.timestamp;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuEvent &event)
+{
+    argument.beginStructure();
+    argument >> event.id >> event.eventId >> event.data >> event.timestamp;
+    argument.endStructure();
+    return argument;
+}
+
+static QVariantMap menuItemProperties(int id)
+{
+    QVariantMap properties;
+    if (id == MENU_ROOT_ID) {
+        properties.insert("children-display", "submenu");
+    } else if (id == MENU_QUIT_ID) {
+        properties.insert("label", "Quit");
+        properties.insert("icon-name", "application-exit");
+    }
+    return properties;
+}
+
+static QVariantMap filterProperties(const QVariantMap &properties, const QStringList &names)
+{
+    if (names.isEmpty()) {
+        return properties;
+    }
+
+    QVariantMap filtered;
+    for (const QString &name : names) {
+        if (properties.contains(name)) {
+            filtered.insert(name, properties.value(name));
+        }
+    }
+    return filtered;
+}
+
+StatusNotifierItem::StatusNotifierItem(const QString &iconName, const QString &iconThemePath, QObject *parent)
+    : QObject(parent), m_iconName(iconName), m_iconThemePath(iconThemePath),
+      m_menu(new QObject(this)), m_watcherWatcher(nullptr), m_exported(false), m_registered(false)
+{
+    qDBusRegisterMetaType<DBusMenuLayoutItem>();
+    qDBusRegisterMetaType<DBusMenuItem>();
+    qDBusRegisterMetaType<DBusMenuItemList>();
+    qDBusRegisterMetaType<DBusMenuItemKeys>();
+    qDBusRegisterMetaType<DBusMenuItemKeysList>();
+    qDBusRegisterMetaType<DBusMenuEvent>();
+    qDBusRegisterMetaType<DBusMenuEventList>();
+
+    new StatusNotifierItemAdaptor(this);
+    new DBusMenuAdaptor(m_menu, this);
+}
+
+QString StatusNotifierItem::iconName() const
+{
+    return m_iconName;
+}
+
+QString StatusNotifierItem::iconThemePath() const
+{
+    return m_iconThemePath;
+}
+
+void StatusNotifierItem::registerWhenHostAvailable()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        return;
+    }
+
+    // The tray can be started or restarted after us
+    m_watcherWatcher = new QDBusServiceWatcher(WATCHER_SERVICE, bus, QDBusServiceWatcher::WatchForRegistration, this);
+    connect(m_watcherWatcher, &QDBusServiceWatcher::serviceRegistered, this, &StatusNotifierItem::onWatcherRegistered);
+
+    bus.connect(WATCHER_SERVICE, WATCHER_PATH, WATCHER_SERVICE, "StatusNotifierHostRegistered",
+                this, SLOT(onHostRegistered()));
+
+    checkHost();
+}
+
+void StatusNotifierItem::checkHost()
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(WATCHER_SERVICE, WATCHER_PATH,
+                                                          "org.freedesktop.DBus.Properties", "Get");
+    message << QString(WATCHER_SERVICE) << QString("IsStatusNotifierHostRegistered");
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *call) {
+        QDBusPendingReply<QDBusVariant> reply = *call;
+        call->deleteLater();
+
+        // No watcher at all is the common case on a phone, nothing to say about it
+        if (reply.isError() || !reply.value().variant().toBool()) {
+            return;
+        }
+
+        onHostRegistered();
+    });
+}
+
+void StatusNotifierItem::onWatcherRegistered()
+{
+    m_registered = false;
+    checkHost();
+}
+
+bool StatusNotifierItem::exportObjects()
+{
+    if (m_exported) {
+        return true;
+    }
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.registerObject(ITEM_PATH, this) || !bus.registerObject(MENU_PATH, m_menu)) {
+        qDebug() << "Can't export the status notifier item";
+        bus.unregisterObject(ITEM_PATH);
+        return false;
+    }
+
+    m_exported = true;
+    return true;
+}
+
+void StatusNotifierItem::onHostRegistered()
+{
+    if (m_registered || !exportObjects()) {
+        return;
+    }
+
+    // Our unique name is enough, the watcher then looks at /StatusNotifierItem
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    QDBusMessage message = QDBusMessage::createMethodCall(WATCHER_SERVICE, WATCHER_PATH, WATCHER_SERVICE,
+                                                          "RegisterStatusNotifierItem");
+    message << bus.baseService();
+    bus.asyncCall(message);
+    m_registered = true;
+}
+
+StatusNotifierItemAdaptor::StatusNotifierItemAdaptor(StatusNotifierItem *parent)
+    : QDBusAbstractAdaptor(parent), m_item(parent)
+{
+}
+
+QDBusObjectPath StatusNotifierItemAdaptor::menu() const
+{
+    return QDBusObjectPath(MENU_PATH);
+}
+
+void StatusNotifierItemAdaptor::Activate(int x, int y)
+{
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    emit m_item->activateRequested();
+}
+
+void StatusNotifierItemAdaptor::SecondaryActivate(int x, int y)
+{
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    emit m_item->activateRequested();
+}
+
+void StatusNotifierItemAdaptor::ContextMenu(int x, int y)
+{
+    // Hosts show the dbusmenu from the Menu property themselves
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+}
+
+void StatusNotifierItemAdaptor::Scroll(int delta, const QString &orientation)
+{
+    Q_UNUSED(delta);
+    Q_UNUSED(orientation);
+}
+
+DBusMenuAdaptor::DBusMenuAdaptor(QObject *parent, StatusNotifierItem *item)
+    : QDBusAbstractAdaptor(parent), m_item(item)
+{
+}
+
+uint DBusMenuAdaptor::GetLayout(int parentId, int recursionDepth, const QStringList &propertyNames, DBusMenuLayoutItem &layout)
+{
+    layout.id = parentId;
+    layout.properties = filterProperties(menuItemProperties(parentId), propertyNames);
+    layout.children.clear();
+
+    if (parentId == MENU_ROOT_ID && recursionDepth != 0) {
+        DBusMenuLayoutItem quit;
+        quit.id = MENU_QUIT_ID;
+        quit.properties = filterProperties(menuItemProperties(MENU_QUIT_ID), propertyNames);
+        layout.children.append(QVariant::fromValue(quit));
+    }
+
+    // The menu never changes
+    return 1;
+}
+
+DBusMenuItemList DBusMenuAdaptor::GetGroupProperties(const QList<int> &ids, const QStringList &propertyNames)
+{
+    DBusMenuItemList items;
+    for (int id : ids) {
+        if (id == MENU_ROOT_ID || id == MENU_QUIT_ID) {
+            items.append({id, filterProperties(menuItemProperties(id), propertyNames)});
+        }
+    }
+    return items;
+}
+
+QDBusVariant DBusMenuAdaptor::GetProperty(int id, const QString &name)
+{
+    return QDBusVariant(menuItemProperties(id).value(name));
+}
+
+void DBusMenuAdaptor::Event(int id, const QString &eventId, const QDBusVariant &data, uint timestamp)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(timestamp);
+
+    if (id == MENU_QUIT_ID && eventId == "clicked") {
+        // Queued, the host is still waiting for the reply
+        QMetaObject::invokeMethod(m_item, &StatusNotifierItem::quitRequested, Qt::QueuedConnection);
+    }
+}
+
+QList<int> DBusMenuAdaptor::EventGroup(const DBusMenuEventList &events)
+{
+    QList<int> idErrors;
+    for (const DBusMenuEvent &event : events) {
+        if (event.id != MENU_ROOT_ID && event.id != MENU_QUIT_ID) {
+            idErrors.append(event.id);
+            continue;
+        }
+        Event(event.id, event.eventId, event.data, event.timestamp);
+    }
+    return idErrors;
+}
+
+bool DBusMenuAdaptor::AboutToShow(int id)
+{
+    Q_UNUSED(id);
+    return false;
+}
+
+QList<int> DBusMenuAdaptor::AboutToShowGroup(const QList<int> &ids, QList<int> &idErrors)
+{
+    for (int id : ids) {
+        if (id != MENU_ROOT_ID && id != MENU_QUIT_ID) {
+            idErrors.append(id);
+        }
+    }
+    return QList<int>();
+}
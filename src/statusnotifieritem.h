@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef STATUSNOTIFIERITEM_H
+#define STATUSNOTIFIERITEM_H
+
+#include <QDBusAbstractAdaptor>
+#include <QDBusArgument>
+#include <QDBusObjectPath>
+#include <QDBusVariant>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+class QDBusServiceWatcher;
+
+// The tray without QtWidgets. Published as an org.kde.StatusNotifierItem with a
+// com.canonical.dbusmenu holding Quit, and only once a StatusNotifier host is
+// registered with the watcher, so there is no cost on compositors without a tray.
+class StatusNotifierItem : public QObject
+{
+    Q_OBJECT
+public:
+    StatusNotifierItem(const QString &iconName, const QString &iconThemePath, QObject *parent = nullptr);
+
+    // Asks the watcher asynchronously, registers when a host is there or shows up later
+    void registerWhenHostAvailable();
+
+    QString iconName() const;
+    QString iconThemePath() const;
+
+signals:
+    void activateRequested();
+    void quitRequested();
+
+private slots:
+    void onWatcherRegistered();
+    void onHostRegistered();
+
+private:
+    void checkHost();
+    bool exportObjects();
+
+    QString m_iconName;
+    QString m_iconThemePath;
+    QObject *m_menu;
+    QDBusServiceWatcher *m_watcherWatcher;
+    bool m_exported;
+    bool m_registered;
+};
+
+// (ia{sv}av), the children being variants of the same
+struct DBusMenuLayoutItem {
+    int id;
+    QVariantMap properties;
+    QVariantList children;
+};
+Q_DECLARE_METATYPE(DBusMenuLayoutItem)
+
+// (ia{sv})
+struct DBusMenuItem {
+    int id;
+    QVariantMap properties;
+};
+Q_DECLARE_METATYPE(DBusMenuItem)
+typedef QList<DBusMenuItem> DBusMenuItemList;
+Q_DECLARE_METATYPE(DBusMenuItemList)
+
+// (ias)
+struct DBusMenuItemKeys {
+    int id;
+    QStringList properties;
+};
+Q_DECLARE_METATYPE(DBusMenuItemKeys)
+typedef QList<DBusMenuItemKeys> DBusMenuItemKeysList;
+Q_DECLARE_METATYPE(DBusMenuItemKeysList)
+
+// (isvu)
+struct DBusMenuEvent {
+    int id;
+    QString eventId;
+    QDBusVariant data;
+    uint timestamp;
+};
+Q_DECLARE_METATYPE(DBusMenuEvent)
+typedef QList<DBusMenuEvent> DBusMenuEventList;
+Q_DECLARE_METATYPE(DBusMenuEventList)
+
+class StatusNotifierItemAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.StatusNotifierItem")
+    Q_PROPERTY(QString Category READ category)
+    Q_PROPERTY(QString Id READ id)
+    Q_PROPERTY(QString Title READ title)
+    Q_PROPERTY(QString Status READ status)
+    Q_PROPERTY(QString IconName READ iconName)
+    Q_PROPERTY(QString IconThemePath READ iconThemePath)
+    Q_PROPERTY(bool ItemIsMenu READ itemIsMenu)
+    Q_PROPERTY(QDBusObjectPath Menu READ menu)
+public:
+    explicit StatusNotifierItemAdaptor(StatusNotifierItem *parent);
+
+    QString category() const { return "ApplicationStatus"; }
+    QString id() const { return "furios-camera"; }
+    QString title() const { return "Camera"; }
+    QString status() const { return "Active"; }
+    QString iconName() const { return m_item->iconName(); }
+    QString iconThemePath() const { return m_item->iconThemePath(); }
+    bool itemIsMenu() const { return false; }
+    QDBusObjectPath menu() const;
+
+public slots:
+    void Activate(int x, int y);
+    void SecondaryActivate(int x, int y);
+    void ContextMenu(int x, int y);
+    void Scroll(int delta, const QString &orientation);
+
+signals:
+    void NewTitle();
+    void NewIcon();
+    void NewStatus(const QString &status);
+
+private:
+    StatusNotifierItem *m_item;
+};
+
+class DBusMenuAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.canonical.dbusmenu")
+    Q_PROPERTY(uint Version READ version)
+    Q_PROPERTY(QString TextDirection READ textDirection)
+    Q_PROPERTY(QString Status READ status)
+    Q_PROPERTY(QStringList IconThemePath READ iconThemePath)
+public:
+    explicit DBusMenuAdaptor(QObject *parent, StatusNotifierItem *item);
+
+    uint version() const { return 3; }
+    QString textDirection() const { return "ltr"; }
+    QString status() const { return "normal"; }
+    QStringList iconThemePath() const { return QStringList(m_item->iconThemePath()); }
+
+public slots:
+    uint GetLayout(int parentId, int recursionDepth, const QStringList &propertyNames, DBusMenuLayoutItem &layout);
+    DBusMenuItemList GetGroupProperties(const QList<int> &ids, const QStringList &propertyNames);
+    QDBusVariant GetProperty(int id, const QString &name);
+    void Event(int id, const QString &eventId, const QDBusVariant &data, uint timestamp);
+    QList<int> EventGroup(const DBusMenuEventList &events);
+    bool AboutToShow(int id);
+    QList<int> AboutToShowGroup(const QList<int> &ids, QList<int> &idErrors);
+
+signals:
+    void ItemsPropertiesUpdated(const DBusMenuItemList &updatedProps, const DBusMenuItemKeysList &removedProps);
+    void LayoutUpdated(uint revision, int parent);
+    void ItemActivationRequested(int id, uint timestamp);
+
+private:
+    StatusNotifierItem *m_item;
+};
+
+#endif // STATUSNOTIFIERITEM_H
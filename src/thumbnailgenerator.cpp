@@ -8,15 +8,22 @@
 // Alexander Rutz <alex@familyrutz.com>
 
 #include "thumbnailgenerator.h"
+#include <QMediaPlayer>
+#include <QVideoProbe>
 
 ThumbnailGenerator::ThumbnailGenerator(QObject *parent) : QObject(parent) {
-    connect(&m_probe, &QVideoProbe::videoFrameProbed, this, &ThumbnailGenerator::processFrame);
-    m_probe.setSource(&m_mediaPlayer);
 }
 
 void ThumbnailGenerator::setVideoSource(const QString &videoSource) {
-    m_mediaPlayer.setMedia(QUrl(videoSource));
-    m_mediaPlayer.play();
+    if (!m_mediaPlayer) {
+        m_mediaPlayer = new QMediaPlayer(this);
+        m_probe = new QVideoProbe(this);
+        connect(m_probe, &QVideoProbe::videoFrameProbed, this, &ThumbnailGenerator::processFrame);
+        m_probe->setSource(m_mediaPlayer);
+    }
+
+    m_mediaPlayer->setMedia(QUrl(videoSource));
+    m_mediaPlayer->play();
 }
 
 QString ThumbnailGenerator::toQmlImage(const QImage &image) {
@@ -35,7 +42,7 @@ void ThumbnailGenerator::processFrame(const QVideoFrame &frame) {
                      cloneFrame.height(),
                      QVideoFrame::imageFormatFromPixelFormat(cloneFrame.pixelFormat()));
         emit thumbnailGenerated(image);
-        m_mediaPlayer.stop();
+        m_mediaPlayer->stop();
         cloneFrame.unmap();
     }
 }
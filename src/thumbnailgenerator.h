@@ -11,12 +11,13 @@
 #define THUMBNAILGENERATOR_H
 
 #include <QObject>
-#include <QMediaPlayer>
-#include <QVideoProbe>
 #include <QVideoFrame>
 #include <QImage>
 #include <QBuffer>
 
+class QMediaPlayer;
+class QVideoProbe;
+
 class ThumbnailGenerator : public QObject
 {
     Q_OBJECT
@@ -32,8 +33,10 @@ private slots:
     void processFrame(const QVideoFrame &frame);
 
 private:
-    QMediaPlayer m_mediaPlayer;
-    QVideoProbe m_probe;
+    // Only made once a video thumbnail is needed, creating the player loads the
+    // GStreamer backend
+    QMediaPlayer *m_mediaPlayer = nullptr;
+    QVideoProbe *m_probe = nullptr;
 };
 
 #endif // THUMBNAILGENERATOR_H
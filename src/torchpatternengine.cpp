@@ -0,0 +1,285 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "torchpatternengine.h"
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// Ramps are written in steps this far apart
+#define RAMP_STEP_NS 10000000LL
+// How often the temperature is read while a pattern runs
+#define THERMAL_CHECK_NS 250000000LL
+#define MISSED_DEADLINE_NS 1000000LL
+
+struct Step {
+    qint64 atNs;
+    qreal level;
+};
+
+static qint64 monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// Faster strobes have phases closer together than the deadline budget
+#define MAX_STROBE_HZ 500.0
+
+static qint64 patternDurationNs(const TorchPattern &pattern)
+{
+    const qint64 timeoutNs = qint64(pattern.timeoutMs) * 1000000LL;
+    return pattern.durationMs > 0 ? qMin(qint64(pattern.durationMs) * 1000000LL, timeoutNs) : timeoutNs;
+}
+
+// Step number index of the pattern, relative to the start, false past the last
+// one. Steps are made as they are played, so a strobe up to a long timeout
+// does not have to be held in memory.
+static bool patternStep(const TorchPattern &pattern, qint64 index, Step &step)
+{
+    const qint64 durationNs = patternDurationNs(pattern);
+
+    switch (pattern.type) {
+    case TorchPattern::Pulse:
+        if (index > 1)
+            return false;
+        step = index == 0 ? Step{0, pattern.brightness} : Step{durationNs, 0};
+        return true;
+    case TorchPattern::Strobe: {
+        if (pattern.frequency <= 0)
+            return false;
+
+        // Phases are computed from the start, so rounding never accumulates
+        const double halfPeriodNs = 1e9 / qMin(qreal(MAX_STROBE_HZ), pattern.frequency) / 2;
+        const qint64 atNs = qint64(index * halfPeriodNs);
+        if (atNs < durationNs) {
+            step = {atNs, index % 2 == 0 ? pattern.brightness : 0};
+            return true;
+        }
+
+        // Off at the end, right after the last phase
+        if (index == 0 || qint64((index - 1) * halfPeriodNs) < durationNs) {
+            step = {durationNs, 0};
+            return true;
+        }
+        return false;
+    }
+    case TorchPattern::Ramp: {
+        const qint64 count = qMax<qint64>(1, durationNs / RAMP_STEP_NS);
+        if (index > count)
+            return false;
+        step = {durationNs * index / count, pattern.from + (pattern.to - pattern.from) * index / count};
+        return true;
+    }
+    }
+
+    return false;
+}
+
+TorchPatternEngine::TorchPatternEngine(QObject *parent)
+    : QThread(parent), m_patternId(0), m_wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), m_thermalFd(-1), m_thermalLimit(0),
+      m_latenessSum(0), m_stopRequested(false)
+{
+}
+
+TorchPatternEngine::~TorchPatternEngine()
+{
+    stop();
+
+    if (m_thermalFd >= 0)
+        ::close(m_thermalFd);
+    ::close(m_wakeFd);
+}
+
+void TorchPatternEngine::setLeds(const QVector<TorchLed> &leds)
+{
+    stop();
+    m_leds = leds;
+}
+
+void TorchPatternEngine::setThermalSensor(const QString &path, int limitMilliCelsius)
+{
+    stop();
+
+    if (m_thermalFd >= 0)
+        ::close(m_thermalFd);
+
+    m_thermalFd = path.isEmpty() ? -1 : ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    m_thermalLimit = limitMilliCelsius;
+}
+
+int TorchPatternEngine::play(const TorchPattern &pattern)
+{
+    stop();
+
+    m_pattern = pattern;
+    m_patternId++;
+    m_stopRequested = false;
+
+    {
+        QMutexLocker locker(&m_statsMutex);
+        m_stats = Stats();
+        m_latenessSum = 0;
+    }
+
+    start();
+    return m_patternId;
+}
+
+void TorchPatternEngine::stop()
+{
+    if (!isRunning())
+        return;
+
+    m_stopRequested = true;
+    eventfd_write(m_wakeFd, 1);
+    wait();
+}
+
+TorchPatternEngine::Stats TorchPatternEngine::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
+
+void TorchPatternEngine::writeLevel(qreal level)
+{
+    char text[16];
+
+    // In the order setLeds got them, switches have to come after the torch
+    // LEDs they latch
+    for (const TorchLed &led : m_leds) {
+        // The dimmest level still lights the LED, 0 is only written for off
+        const int value = level <= 0 ? 0 : led.isSwitch ? 1 : qMax(1, int(std::lround(level * led.maxBrightness)));
+        const int length = snprintf(text, sizeof(text), "%d", value);
+
+        if (::pwrite(led.fd, text, length, 0) < 0)
+            qDebug() << "Failed to write" << led.path;
+    }
+}
+
+bool TorchPatternEngine::overThermalLimit()
+{
+    if (m_thermalFd < 0)
+        return false;
+
+    char text[16];
+    const ssize_t length = ::pread(m_thermalFd, text, sizeof(text) - 1, 0);
+    if (length <= 0)
+        return false;
+
+    text[length] = '\0';
+    return atoi(text) >= m_thermalLimit;
+}
+
+void TorchPatternEngine::recordLateness(qint64 latenessNs)
+{
+    QMutexLocker locker(&m_statsMutex);
+
+    latenessNs = qMax<qint64>(0, latenessNs);
+    m_stats.steps++;
+    m_latenessSum += latenessNs;
+    m_stats.meanLatenessNs = m_latenessSum / qint64(m_stats.steps);
+    m_stats.maxLatenessNs = qMax(m_stats.maxLatenessNs, latenessNs);
+    if (latenessNs >= MISSED_DEADLINE_NS)
+        m_stats.missed++;
+}
+
+void TorchPatternEngine::run()
+{
+    // Timers on this thread fire on time instead of within the default 50us
+    // slack, and a real-time priority keeps the GUI from delaying the writes.
+    // Both are best effort, without CAP_SYS_NICE the thread stays SCHED_OTHER.
+    prctl(PR_SET_TIMERSLACK, 1UL);
+    sched_param param = {};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    eventfd_t drained;
+    eventfd_read(m_wakeFd, &drained);
+
+    const int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timerFd < 0) {
+        qWarning() << "Torch: timerfd_create failed";
+        emit patternFinished(m_patternId, QStringLiteral("stopped"));
+        return;
+    }
+
+    const qint64 timeoutNs = qint64(m_pattern.timeoutMs) * 1000000LL;
+    Step step;
+    qint64 index = 0;
+    bool more = patternStep(m_pattern, index, step);
+
+    // A ramp holds its last level until the timeout turns it off, the other
+    // patterns end with an off step, which is the timeout when they were cut short
+    const bool holds = m_pattern.type == TorchPattern::Ramp || !more;
+    bool held = false;
+    QString reason = holds || patternDurationNs(m_pattern) >= timeoutNs ? QStringLiteral("timeout") : QStringLiteral("done");
+
+    const qint64 start = monotonicNs();
+    qint64 lastThermalCheck = 0;
+
+    while (more || (holds && !held)) {
+        if (!more) {
+            step = {timeoutNs, 0};
+            held = true;
+        }
+
+        const qint64 deadline = start + step.atNs;
+
+        itimerspec spec = {};
+        spec.it_value.tv_sec = deadline / 1000000000LL;
+        spec.it_value.tv_nsec = deadline % 1000000000LL;
+        timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+        bool fired = false;
+        while (!fired && !m_stopRequested) {
+            if (monotonicNs() - lastThermalCheck >= THERMAL_CHECK_NS) {
+                lastThermalCheck = monotonicNs();
+                if (overThermalLimit())
+                    break;
+            }
+
+            pollfd fds[2] = {{timerFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+            if (poll(fds, 2, THERMAL_CHECK_NS / 1000000) > 0 && (fds[0].revents & POLLIN)) {
+                uint64_t expirations;
+                fired = ::read(timerFd, &expirations, sizeof(expirations)) == sizeof(expirations);
+            }
+        }
+
+        if (m_stopRequested) {
+            reason = QStringLiteral("stopped");
+            break;
+        }
+
+        if (!fired) {
+            qWarning() << "Torch: thermal limit reached, stopping pattern";
+            reason = QStringLiteral("thermal");
+            break;
+        }
+
+        writeLevel(step.level);
+        recordLateness(monotonicNs() - deadline);
+
+        more = !held && patternStep(m_pattern, ++index, step);
+    }
+
+    ::close(timerFd);
+
+    if (reason == "stopped" || reason == "thermal")
+        writeLevel(0);
+
+    emit patternFinished(m_patternId, reason);
+}
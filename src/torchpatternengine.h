@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef TORCHPATTERNENGINE_H
+#define TORCHPATTERNENGINE_H
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+
+// Brightness file of one LED, opened once by FlashlightController
+struct TorchLed {
+    QString path;
+    int fd;
+    int maxBrightness;
+    // led:switch style LEDs gate the torch LEDs and only take 0 or 1
+    bool isSwitch;
+};
+
+struct TorchPattern {
+    enum Type {
+        // On for durationMs, then off
+        Pulse,
+        // On and off at frequency Hz, at most 500, for durationMs, or until stopped
+        Strobe,
+        // From "from" to "to" over durationMs, then held until stopped
+        Ramp
+    };
+
+    Type type = Pulse;
+    int durationMs = 0;
+    qreal frequency = 0;
+    qreal from = 0;
+    qreal to = 1;
+    // Level of the on phases of Pulse and Strobe, 0 to 1 of max_brightness
+    qreal brightness = 1;
+    // Hard limit for any pattern, including held ramps
+    int timeoutMs = 10000;
+};
+
+// Plays torch patterns on its own thread. Every step has an absolute
+// CLOCK_MONOTONIC deadline on a timerfd, so a late wakeup never shifts the
+// steps after it, and the LEDs are written straight to their open fds.
+class TorchPatternEngine : public QThread
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        quint64 steps = 0;
+        // Steps written a millisecond or more after their deadline
+        quint64 missed = 0;
+        qint64 meanLatenessNs = 0;
+        qint64 maxLatenessNs = 0;
+    };
+
+    explicit TorchPatternEngine(QObject *parent = nullptr);
+    ~TorchPatternEngine();
+
+    // Written in this order on every step
+    void setLeds(const QVector<TorchLed> &leds);
+    // File with the temperature in millidegrees Celsius, checked while a pattern runs
+    void setThermalSensor(const QString &path, int limitMilliCelsius);
+
+    // Replaces the running pattern, if any, and returns the id patternFinished reports
+    int play(const TorchPattern &pattern);
+    // Blocks until the thread has turned the LEDs off and exited
+    void stop();
+
+    Stats stats() const;
+
+signals:
+    // reason is "done", "stopped", "timeout" or "thermal"
+    void patternFinished(int id, const QString &reason);
+
+protected:
+    void run() override;
+
+private:
+    void writeLevel(qreal level);
+    bool overThermalLimit();
+    void recordLateness(qint64 latenessNs);
+
+    QVector<TorchLed> m_leds;
+    TorchPattern m_pattern;
+    int m_patternId;
+    int m_wakeFd;
+    int m_thermalFd;
+    int m_thermalLimit;
+
+    mutable QMutex m_statsMutex;
+    Stats m_stats;
+    qint64 m_latenessSum;
+    std::atomic<bool> m_stopRequested;
+};
+
+#endif // TORCHPATTERNENGINE_H
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "wificonnectionindex.h"
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMetaType>
+#include <QDBusObjectPath>
+#include <QDBusPendingCallWatcher>
+#include <QDBusServiceWatcher>
+#include <QDebug>
+
+#define NM_SERVICE "org.freedesktop.NetworkManager"
+#define NM_SETTINGS_PATH "/org/freedesktop/NetworkManager/Settings"
+#define NM_SETTINGS_INTERFACE "org.freedesktop.NetworkManager.Settings"
+#define NM_SETTINGS_CONNECTION_INTERFACE "org.freedesktop.NetworkManager.Settings.Connection"
+
+typedef QMap<QString, QVariantMap> ConnectionSettings;
+
+WifiConnectionIndex::WifiConnectionIndex(QObject *parent) : QObject(parent), m_pendingLoads(0), m_ready(false), m_generation(0) {
+    qDBusRegisterMetaType<ConnectionSettings>();
+
+    QDBusConnection bus = QDBusConnection::systemBus();
+
+    bus.connect(NM_SERVICE, NM_SETTINGS_PATH, NM_SETTINGS_INTERFACE, "NewConnection",
+                this, SLOT(onNewConnection(QDBusObjectPath)));
+    bus.connect(NM_SERVICE, NM_SETTINGS_PATH, NM_SETTINGS_INTERFACE, "ConnectionRemoved",
+                this, SLOT(onConnectionRemoved(QDBusObjectPath)));
+    // An empty path subscribes to Updated on every profile
+    bus.connect(NM_SERVICE, QString(), NM_SETTINGS_CONNECTION_INTERFACE, "Updated",
+                this, SLOT(onConnectionUpdated(QDBusMessage)));
+
+    m_watcher = new QDBusServiceWatcher(NM_SERVICE, bus, QDBusServiceWatcher::WatchForOwnerChange, this);
+    connect(m_watcher, &QDBusServiceWatcher::serviceOwnerChanged, this, &WifiConnectionIndex::onServiceOwnerChanged);
+
+    reload();
+}
+
+bool WifiConnectionIndex::isReady() const {
+    return m_ready;
+}
+
+QStringList WifiConnectionIndex::connections(const QString &ssid) const {
+    return m_bySsid.values(ssid);
+}
+
+void WifiConnectionIndex::reload() {
+    m_generation++;
+    m_bySsid.clear();
+    m_byPath.clear();
+    m_pendingLoads = 1;
+
+    QDBusMessage list = QDBusMessage::createMethodCall(NM_SERVICE, NM_SETTINGS_PATH, NM_SETTINGS_INTERFACE, "ListConnections");
+
+    const quint32 generation = m_generation;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(list), this);
+
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, generation](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+
+        if (generation != m_generation) {
+            return;
+        }
+
+        const QDBusMessage reply = watcher->reply();
+
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "Failed to list connections" << reply.errorMessage();
+        } else {
+            for (const QDBusObjectPath &path : qdbus_cast<QList<QDBusObjectPath>>(reply.arguments().value(0))) {
+                indexConnection(path.path());
+            }
+        }
+
+        loadFinished();
+    });
+}
+
+void WifiConnectionIndex::indexConnection(const QString &path) {
+    QDBusMessage get = QDBusMessage::createMethodCall(NM_SERVICE, path, NM_SETTINGS_CONNECTION_INTERFACE, "GetSettings");
+
+    const quint32 generation = m_generation;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(get), this);
+    m_pendingLoads++;
+
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, path, generation](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+
+        if (generation != m_generation) {
+            return;
+        }
+
+        const QDBusMessage reply = watcher->reply();
+
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qWarning() << "Failed to get settings for connection:" << path;
+        } else {
+            const ConnectionSettings settings = qdbus_cast<ConnectionSettings>(reply.arguments().value(0));
+
+            // Updated replaces whatever the profile was indexed under before
+            removeConnection(path);
+
+            if (settings["connection"]["type"].toString() == "802-11-wireless") {
+                const QString ssid = QString::fromUtf8(settings["802-11-wireless"]["ssid"].toByteArray());
+                m_bySsid.insert(ssid, path);
+                m_byPath.insert(path, ssid);
+            }
+        }
+
+        loadFinished();
+    });
+}
+
+void WifiConnectionIndex::removeConnection(const QString &path) {
+    auto it = m_byPath.find(path);
+    if (it != m_byPath.end()) {
+        m_bySsid.remove(it.value(), path);
+        m_byPath.erase(it);
+    }
+}
+
+void WifiConnectionIndex::loadFinished() {
+    if (--m_pendingLoads == 0 && !m_ready) {
+        m_ready = true;
+        qDebug() << "Indexed" << m_byPath.size() << "Wi-Fi connections";
+        emit ready();
+    }
+}
+
+void WifiConnectionIndex::onNewConnection(const QDBusObjectPath &path) {
+    indexConnection(path.path());
+}
+
+void WifiConnectionIndex::onConnectionRemoved(const QDBusObjectPath &path) {
+    removeConnection(path.path());
+}
+
+void WifiConnectionIndex::onConnectionUpdated(const QDBusMessage &message) {
+    indexConnection(message.path());
+}
+
+void WifiConnectionIndex::onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner) {
+    Q_UNUSED(service);
+    Q_UNUSED(oldOwner);
+    Q_UNUSED(newOwner);
+
+    // NetworkManager restarted and renumbered its profiles
+    m_ready = false;
+    reload();
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef WIFICONNECTIONINDEX_H
+#define WIFICONNECTIONINDEX_H
+
+#include <QObject>
+#include <QDBusMessage>
+#include <QHash>
+#include <QMultiHash>
+
+class QDBusObjectPath;
+class QDBusServiceWatcher;
+
+// Maps SSIDs to the saved NetworkManager profiles using them. Built once with all
+// GetSettings calls in flight at the same time, then kept current through
+// NewConnection, ConnectionRemoved and each profile's Updated signal.
+class WifiConnectionIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WifiConnectionIndex(QObject *parent = nullptr);
+
+    // True once every profile listed at start has been indexed
+    bool isReady() const;
+    QStringList connections(const QString &ssid) const;
+
+signals:
+    void ready();
+
+private slots:
+    void onNewConnection(const QDBusObjectPath &path);
+    void onConnectionRemoved(const QDBusObjectPath &path);
+    void onConnectionUpdated(const QDBusMessage &message);
+    void onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
+
+private:
+    void reload();
+    void indexConnection(const QString &path);
+    void removeConnection(const QString &path);
+    void loadFinished();
+
+    QMultiHash<QString, QString> m_bySsid;
+    QHash<QString, QString> m_byPath;
+    QDBusServiceWatcher *m_watcher;
+    int m_pendingLoads;
+    bool m_ready;
+    quint32 m_generation;
+};
+
+#endif // WIFICONNECTIONINDEX_H
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#include "wifisignalmonitor.h"
+#include "networkmanagerclient.h"
+
+WifiSignalMonitor::WifiSignalMonitor(NetworkManagerClient *networkManager, QObject *parent)
+    : QObject(parent), m_networkManager(networkManager), m_strength(0), m_icon(OFFLINE_SIGNAL) {
+    connect(m_networkManager, &NetworkManagerClient::ready, this, &WifiSignalMonitor::resolveAccessPoint);
+    connect(m_networkManager, &NetworkManagerClient::devicesChanged, this, &WifiSignalMonitor::resolveAccessPoint);
+    connect(m_networkManager, &NetworkManagerClient::wirelessEnabledChanged, this, &WifiSignalMonitor::update);
+    connect(m_networkManager, &NetworkManagerClient::propertiesChanged, this, &WifiSignalMonitor::onPropertiesChanged);
+    connect(m_networkManager, &NetworkManagerClient::accessPointAdded, this, &WifiSignalMonitor::onAccessPointAdded);
+    connect(m_networkManager, &NetworkManagerClient::accessPointRemoved, this, &WifiSignalMonitor::onAccessPointRemoved);
+}
+
+void WifiSignalMonitor::setSsid(const QString &ssid) {
+    if (m_ssid == ssid) {
+        return;
+    }
+
+    m_ssid = ssid;
+    resolveAccessPoint();
+}
+
+int WifiSignalMonitor::signalStrength() const {
+    return m_strength;
+}
+
+QString WifiSignalMonitor::signalIcon() const {
+    return m_icon;
+}
+
+void WifiSignalMonitor::resolveAccessPoint() {
+    m_accessPoint = m_ssid.isEmpty() ? QString() : m_networkManager->findAccessPoint(m_ssid);
+    update();
+}
+
+void WifiSignalMonitor::onPropertiesChanged(const QString &path, const QString &interface, const QStringList &names) {
+    Q_UNUSED(interface);
+
+    if (m_accessPoint.isEmpty()) {
+        // A new access point only has its SSID once its properties are loaded
+        if (names.contains("Ssid")) {
+            resolveAccessPoint();
+        }
+    } else if (path == m_accessPoint && names.contains("Strength")) {
+        update();
+    }
+}
+
+void WifiSignalMonitor::onAccessPointAdded(const QString &device, const QString &accessPoint) {
+    Q_UNUSED(device);
+    Q_UNUSED(accessPoint);
+
+    if (m_accessPoint.isEmpty() && !m_ssid.isEmpty()) {
+        resolveAccessPoint();
+    }
+}
+
+void WifiSignalMonitor::onAccessPointRemoved(const QString &device, const QString &accessPoint) {
+    Q_UNUSED(device);
+
+    if (accessPoint == m_accessPoint) {
+        resolveAccessPoint();
+    }
+}
+
+void WifiSignalMonitor::update() {
+    int strength = 0;
+    QString icon;
+
+    if (!m_networkManager->wirelessEnabled()) {
+        icon = OFFLINE_SIGNAL;
+    } else {
+        strength = m_accessPoint.isEmpty() ? 0 : m_networkManager->accessPointStrength(m_accessPoint);
+
+        if (strength <= 0)
+            icon = NO_ROUTE_SIGNAL;
+        else if (strength < 20)
+            icon = NONE_SIGNAL;
+        else if (strength < 40)
+            icon = WEAK_SIGNAL;
+        else if (strength < 50)
+            icon = OK_SIGNAL;
+        else if (strength < 80)
+            icon = GOOD_SIGNAL;
+        else
+            icon = EXCELLENT_SIGNAL;
+    }
+
+    if (strength != m_strength || icon != m_icon) {
+        m_strength = strength;
+        m_icon = icon;
+        emit signalChanged();
+    }
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2024 Furi Labs
+
+#ifndef WIFISIGNALMONITOR_H
+#define WIFISIGNALMONITOR_H
+
+#include <QObject>
+
+#define NO_ROUTE_SIGNAL QString("image://icons/network-wireless-signal-no-route.svg")
+#define OFFLINE_SIGNAL QString("image://icons/network-wireless-signal-offline.svg")
+#define NONE_SIGNAL QString("image://icons/network-wireless-signal-none.svg")
+#define WEAK_SIGNAL QString("image://icons/network-wireless-signal-weak.svg")
+#define OK_SIGNAL QString("image://icons/network-wireless-signal-ok.svg")
+#define GOOD_SIGNAL QString("image://icons/network-wireless-signal-good.svg")
+#define EXCELLENT_SIGNAL QString("image://icons/network-wireless-signal-excellent.svg")
+
+class NetworkManagerClient;
+
+// Follows the signal strength of one SSID. The access point is resolved once from
+// the NetworkManager cache and then only its Strength changes are listened to;
+// it is looked up again only when it disappears or a new one shows up while we
+// have none.
+class WifiSignalMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int signalStrength READ signalStrength NOTIFY signalChanged)
+    Q_PROPERTY(QString signalIcon READ signalIcon NOTIFY signalChanged)
+
+public:
+    explicit WifiSignalMonitor(NetworkManagerClient *networkManager, QObject *parent = nullptr);
+
+    void setSsid(const QString &ssid);
+    int signalStrength() const;
+    QString signalIcon() const;
+
+signals:
+    void signalChanged();
+
+private slots:
+    void resolveAccessPoint();
+    void onPropertiesChanged(const QString &path, const QString &interface, const QStringList &names);
+    void onAccessPointAdded(const QString &device, const QString &accessPoint);
+    void onAccessPointRemoved(const QString &device, const QString &accessPoint);
+
+private:
+    void update();
+
+    NetworkManagerClient *m_networkManager;
+    QString m_ssid;
+    QString m_accessPoint;
+    int m_strength;
+    QString m_icon;
+};
+
+#endif // WIFISIGNALMONITOR_H
@@ -8,12 +8,15 @@
 
 #include <ReadBarcode.h>
 
+#include "latencyhistogram.h"
+
 #include <QImage>
 #include <QDebug>
 #include <QMetaType>
 #include <QScopeGuard>
 #include <QQmlEngine>
 #include <algorithm>
+#include <numeric>
 
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
 #include <QAbstractVideoFilter>
@@ -22,6 +25,7 @@
 #include <QVideoSink>
 #endif
 
+#include <QCoreApplication>
 #include <QElapsedTimer>
 #include <QTimer>
 #include <QtConcurrent/QtConcurrent>
@@ -296,6 +300,134 @@ inline Result ReadBarcode(const QVideoFrame& frame, const ReaderOptions& opts =
 	return !res.isEmpty() ? res.takeFirst() : Result();
 }
 
+// Spreads the enabled formats over successive frames. Decoding every linear and matrix
+// symbology on each frame is too slow on phone hardware, so the formats are split into
+// groups that are cheap to decode on their own and each frame only tries one of them.
+// Every group gets at least one slot per rotation period, the remaining slots go to the
+// groups that produced results recently, so the common case costs about as much as
+// scanning for a single symbology. Not thread safe, BarcodeReader only uses it from
+// the GUI thread.
+class FormatScheduler
+{
+public:
+	void setFormats(int formats)
+	{
+		static const int families[] = {
+			int(BarcodeFormat::QRCode) | int(BarcodeFormat::MicroQRCode) | int(BarcodeFormat::RMQRCode),
+			int(BarcodeFormat::DataMatrix) | int(BarcodeFormat::Aztec) | int(BarcodeFormat::PDF417) | int(BarcodeFormat::MaxiCode),
+			int(BarcodeFormat::EAN8) | int(BarcodeFormat::EAN13) | int(BarcodeFormat::UPCA) | int(BarcodeFormat::UPCE),
+			int(BarcodeFormat::Code128) | int(BarcodeFormat::Code39) | int(BarcodeFormat::Code93) | int(BarcodeFormat::Codabar)
+				| int(BarcodeFormat::ITF) | int(BarcodeFormat::DataBar) | int(BarcodeFormat::DataBarExpanded),
+		};
+
+		// An empty format set means "everything" to ZXing
+		if (formats == 0)
+			formats = int(BarcodeFormat::LinearCodes) | int(BarcodeFormat::MatrixCodes);
+
+		_groups.clear();
+		for (int family : families) {
+			if (formats & family)
+				_groups.append(formats & family);
+		}
+		_scores.fill(0.0, _groups.size());
+		_locked = -1;
+		rebuild();
+	}
+
+	// Number of frames in which every group is tried at least once, 0 picks a default
+	void setPeriod(int period)
+	{
+		_period = period;
+		rebuild();
+	}
+	int period() const { return _schedule.size(); }
+
+	// Formats to try on the next frame
+	int next()
+	{
+		if (_groups.isEmpty())
+			return 0;
+		if (_locked >= 0)
+			return _groups[_locked];
+		if (_slot >= _schedule.size())
+			rebuild();
+		return _groups[_schedule[_slot++]];
+	}
+
+	// While a code is being tracked only its own group is scanned so the overlay stays smooth
+	void recordResult(BarcodeFormat format, bool valid)
+	{
+		_locked = -1;
+		if (!valid)
+			return;
+
+		for (int i = 0; i < _groups.size(); i++) {
+			if (_groups[i] & int(format)) {
+				_scores[i] += 1.0;
+				_locked = i;
+				break;
+			}
+		}
+	}
+
+private:
+	void rebuild()
+	{
+		_slot = 0;
+		_schedule.clear();
+
+		const int count = _groups.size();
+		if (count <= 1) {
+			_schedule.append(0);
+			return;
+		}
+
+		// By default the most successful group gets every other frame
+		const int length = std::max(count, _period > 0 ? _period : 2 * (count - 1));
+
+		QVector<int> order(count);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return _scores[a] > _scores[b]; });
+
+		double total = std::accumulate(_scores.begin(), _scores.end(), 0.0);
+		QVector<int> slots(count, 1);
+		int spare = length - count;
+		if (total > 0) {
+			for (int i : order) {
+				int share = int(spare * _scores[i] / total);
+				slots[i] += share;
+			}
+			spare = length - std::accumulate(slots.begin(), slots.end(), 0);
+		}
+		slots[order.first()] += spare;
+
+		// Smooth weighted round robin, so a group's slots are spread over the period
+		// instead of running back to back
+		QVector<int> current(count, 0);
+		for (int n = 0; n < length; n++) {
+			int best = 0;
+			for (int i = 0; i < count; i++) {
+				current[i] += slots[i];
+				if (current[i] > current[best])
+					best = i;
+			}
+			current[best] -= length;
+			_schedule.append(best);
+		}
+
+		// Age the hit history so a symbology that stops showing up loses its extra slots
+		for (double& score : _scores)
+			score *= 0.5;
+	}
+
+	QVector<int> _groups;
+	QVector<double> _scores;
+	QVector<int> _schedule;
+	int _slot = 0;
+	int _period = 0;
+	int _locked = -1;
+};
+
 #define ZQ_PROPERTY(Type, name, setter) \
 public: \
 	Q_PROPERTY(Type name READ name WRITE setter NOTIFY name##Changed) \
@@ -320,10 +452,15 @@ class BarcodeReader : public QObject, private ReaderOptions
 
 public:
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-	BarcodeReader(QObject* parent = nullptr) : QAbstractVideoFilter(parent), busy(false), sleepTime(200), cropRect(0, 0, 0, 0) {}
+	BarcodeReader(QObject* parent = nullptr) : QAbstractVideoFilter(parent), busy(false), sleepTime(200), cropRect(0, 0, 0, 0)
 #else
-	BarcodeReader(QObject* parent = nullptr) : QObject(parent) {}
+	BarcodeReader(QObject* parent = nullptr) : QObject(parent)
 #endif
+	{
+		_clock.start();
+		if (QCoreApplication::instance())
+			connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &BarcodeReader::logLatencyStats);
+	}
 
 	Q_PROPERTY(int formats READ formats WRITE setFormats NOTIFY formatsChanged)
 	int formats() const noexcept
@@ -335,26 +472,91 @@ public:
 	{
 		if (formats() != newVal) {
 			ReaderOptions::setFormats(static_cast<ZXing::BarcodeFormat>(newVal));
+			_scheduler.setFormats(newVal);
 			emit formatsChanged();
+			emit effectiveRotationPeriodChanged();
 			qDebug() << ReaderOptions::formats();
 		}
 	}
 	Q_SIGNAL void formatsChanged();
 
+	// As set, 0 lets the scheduler pick one
+	Q_PROPERTY(int rotationPeriod READ rotationPeriod WRITE setRotationPeriod NOTIFY rotationPeriodChanged)
+	int rotationPeriod() const noexcept { return _rotationPeriod; }
+	Q_SLOT void setRotationPeriod(int newVal)
+	{
+		if (_rotationPeriod != newVal) {
+			_rotationPeriod = newVal;
+			_scheduler.setPeriod(newVal);
+			emit rotationPeriodChanged();
+			emit effectiveRotationPeriodChanged();
+		}
+	}
+	Q_SIGNAL void rotationPeriodChanged();
+
+	// Frames the scheduler actually rotates over for the current formats
+	Q_PROPERTY(int effectiveRotationPeriod READ effectiveRotationPeriod NOTIFY effectiveRotationPeriodChanged)
+	int effectiveRotationPeriod() const noexcept { return _scheduler.period(); }
+	Q_SIGNAL void effectiveRotationPeriodChanged();
+
 	ZQ_PROPERTY(bool, tryRotate, setTryRotate)
 	ZQ_PROPERTY(bool, tryHarder, setTryHarder)
 	ZQ_PROPERTY(bool, tryDownscale, setTryDownscale)
 
+	// Time from a frame entering the filter to its result, split into image
+	// conversion, waiting for a decoder thread and decoding
+	Q_PROPERTY(QVariantMap latencyStats READ latencyStats NOTIFY latencyStatsChanged)
+	QVariantMap latencyStats() const
+	{
+		return QVariantMap{
+			{"conversion", _conversionLatency.toVariantMap()},
+			{"queue", _queueLatency.toVariantMap()},
+			{"decode", _decodeLatency.toVariantMap()},
+			{"total", _totalLatency.toVariantMap()},
+		};
+	}
+	Q_SIGNAL void latencyStatsChanged();
+
+	Q_INVOKABLE void resetLatencyStats()
+	{
+		_conversionLatency.reset();
+		_queueLatency.reset();
+		_decodeLatency.reset();
+		_totalLatency.reset();
+		emit latencyStatsChanged();
+	}
+
+	QString latencySummary() const
+	{
+		return QString("conversion: %1\nqueue: %2\ndecode: %3\ntotal: %4")
+			.arg(_conversionLatency.summary(), _queueLatency.summary(), _decodeLatency.summary(), _totalLatency.summary());
+	}
+
+	Q_SLOT void logLatencyStats()
+	{
+		if (_totalLatency.count() > 0)
+			qInfo().noquote() << "Barcode scanner latency\n" + latencySummary();
+	}
+
 	bool busy;
 	int sleepTime;
 	QRect cropRect;
 
+	// Sampling interval while nothing is found and while a code is being tracked
+	int idleSleepTime = 200;
+	int trackingSleepTime = 20;
+	// Extra image-space margin around a found code, and the smallest crop we decode
+	int cropPadding = 200;
+	int minCropSize = 500;
+
 public slots:
-	void process(const QVideoFrame& image)
+	// Returns false when the frame was dropped because a decode is still running
+	bool process(const QVideoFrame& image)
 	{
-		if (busy) return;
+		if (busy) return false;
 
 		busy = true;
+		_frameArrived = _clock.nsecsElapsed();
 
 		// Disable ourselves for a bit -- we don't need to sample at full throttle
 		setActive(false);
@@ -372,18 +574,36 @@ public slots:
 			img = img.copy(cropRect);
 		}
 
-		QtConcurrent::run(this, &BarcodeReader::process_internal, img);
+		_frameConverted = _clock.nsecsElapsed();
+		QtConcurrent::run(this, &BarcodeReader::process_internal, img, _scheduler.next());
+		return true;
 	}
 
-	void process_internal(QImage &image)
+	void process_internal(QImage &image, int formats)
 	{
-		Result res = ReadBarcode(image, *this);
+		const qint64 decodeStart = _clock.nsecsElapsed();
+
+		Result res = ReadBarcode(image, ReaderOptions(*this).setFormats(static_cast<ZXing::BarcodeFormat>(formats)));
+
+		const qint64 decodeEnd = _clock.nsecsElapsed();
+		res.runTime = (decodeEnd - decodeStart) / 1000000;
+		// The scheduler belongs to the GUI thread, where the formats and period
+		// are changed too
+		const BarcodeFormat format = res.format();
+		const bool valid = res.isValid();
+		QMetaObject::invokeMethod(this, [this, format, valid]() { _scheduler.recordResult(format, valid); }, Qt::QueuedConnection);
 		if (!cropRect.isNull()) {
 			for (int i = 0; i < 4; i++) {
 				res._position[i] += cropRect.topLeft();
 			}
 		}
+
+		_conversionLatency.record(_frameConverted - _frameArrived);
+		_queueLatency.record(decodeStart - _frameConverted);
+		_decodeLatency.record(decodeEnd - decodeStart);
+		_totalLatency.record(_clock.nsecsElapsed() - _frameArrived);
 		emit newResult(res);
+		emit latencyStatsChanged();
 
 		if (res.isValid()) {
 			// We have a code! Sample more often and only around the area where we found the code
@@ -406,20 +626,20 @@ public slots:
 			cropRect.setTopLeft(topLeft);
 			cropRect.setBottomRight(bottomRight);
 
-			int w = std::max(500, std::min(cropRect.width() * 2, cropRect.width() + 200));
-			int h = std::max(500, std::min(cropRect.height() * 2, cropRect.height() + 200));
+			int w = std::max(minCropSize, std::min(cropRect.width() * 2, cropRect.width() + cropPadding));
+			int h = std::max(minCropSize, std::min(cropRect.height() * 2, cropRect.height() + cropPadding));
 
 			cropRect.moveTopLeft(cropRect.topLeft() - (QPoint(w, h) - QPoint(cropRect.width(), cropRect.height())) / 2);
 			cropRect.setSize(QSize(w, h));
 
 			// Wake from our slumber
 
-			if (sleepTime != 20) {
-				sleepTime = 20;
+			if (sleepTime != trackingSleepTime) {
+				sleepTime = trackingSleepTime;
 				setActive(true);
 			}
 		} else {
-			sleepTime = 200;
+			sleepTime = idleSleepTime;
 			cropRect.setRect(0, 0, 0, 0);
 		}
 
@@ -429,6 +649,18 @@ public slots:
 signals:
 	void newResult(ZXingQt::Result result);
 
+private:
+	FormatScheduler _scheduler;
+	int _rotationPeriod = 0;
+
+	QElapsedTimer _clock;
+	qint64 _frameArrived = 0;
+	qint64 _frameConverted = 0;
+	LatencyHistogram _conversionLatency;
+	LatencyHistogram _queueLatency;
+	LatencyHistogram _decodeLatency;
+	LatencyHistogram _totalLatency;
+
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
 public:
 	QVideoFilterRunnable *createFilterRunnable() override;